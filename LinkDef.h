@@ -2,5 +2,4 @@
 #pragma link C++ class WaveDRS+;
 #pragma link C++ class WaveformMPPC+;
 #pragma link C++ class EventLYSO+;
-#pragma link C++ class std::vector<WaveformMPPC>;
 #endif
\ No newline at end of file
@@ -23,115 +23,252 @@
 #include "eventlyso.hh"
 #include "waveformmppc.hh"
 #include "configure.hh"
+#include "loopanalyzer.hh"
+#include "batchanalyzer.hh"
+#include "shardlyso.hh"
+#include "metricslyso.hh"
 
 using namespace std;
 using namespace ROOT;
 
 
 
-const char* GenerateOutputFilename(const std::string& barFilename)
-{
-    // Regular expression per estrarre XXXXX e Y (opzionale)
-    std::regex pattern(R"(\/BarID_(\d+)(?:_t(\d+))?\.root$)");
-    std::smatch matches;
-
-    // Cerca il pattern
-    if (std::regex_search(barFilename, matches, pattern)) {
-        std::string id = matches[1];  // XXXXX
-        std::string suffix;
-
-        // Controlla se esiste il parametro Y e lo aggiunge al suffisso se presente
-        if (matches.size() > 2 && matches[2].matched) {
-            suffix = "_t" + matches[2].str();  // "_tY"
-        }
-
-        // Costruisce il filename finale
-        static std::string outputFilename = "RootFiles/AnalyzerID_" + id + suffix + ".root";
-        return outputFilename.c_str();
-    } else {
-        std::cerr << "Filename format not recognized." << std::endl;
-        return "";
-    }
-}
-
-
-
-
 int main(int argc, char** argv)
 {
     if(argc < 3)
     {
-        cerr << "Usage: " << argv[0] << " <barFilename> <configFilename>" << endl;
+        cerr << "Usage: " << argv[0] << " <barFilename|list|directory|glob> <configFilename> [--threads N] [--ordered] [--format ttree|rntuple] [--read-ahead N] [--readers M] [--jobs J] [--force] [--first-entry A] [--last-entry B] [--shard i/N] [--checkpoint N] [--write-cache F] [--cache-circles C] [--from-cache F] [--scan S] [--metrics PREFIX] [--metrics-period S] [--profile-hw]" << endl;
         return 1;
     }
 
     const char *barFilename = argv[1];
     const char *configFilename = argv[2];
-    const char *outputFilename = GenerateOutputFilename(barFilename);
-
-    Int_t fEvent;
-    vector<RVecF> *fTime_F = 0;
-    vector<RVecF> *fTime_B = 0;
-    vector<RVecF> *fFront = 0; 
-    vector<RVecF> *fBack = 0; 
-    
-    unique_ptr<TFile> barFile(TFile::Open(barFilename, "READ"));
-    TTree *lyso_wfs_times = barFile->Get<TTree>("lyso_wfs_times");
-    TTree *lyso_wfs = barFile->Get<TTree>("lyso_wfs");
-
-    lyso_wfs->SetBranchAddress("Event", &fEvent);
-    lyso_wfs_times->SetBranchAddress("Time_F", &fTime_F);
-    lyso_wfs_times->SetBranchAddress("Time_B", &fTime_B);
-    lyso_wfs->SetBranchAddress("Front", &fFront);
-    lyso_wfs->SetBranchAddress("Back", &fBack);
-
-    lyso_wfs_times->GetEntry(0);
-    vector<RVecD> fTime_F_data(fTime_F->begin(), fTime_F->end());
-    vector<RVecD> fTime_B_data(fTime_B->begin(), fTime_B->end());
-
-    Int_t nEntries = lyso_wfs->GetEntries();
-    
-    cout << "AnalyzerWT>> Entries = " << nEntries << endl;
-
-    unique_ptr<EventLYSO> eventlyso = nullptr;
-    EventLYSO* eventlyso_ptr = nullptr;
-    
-    unique_ptr<TFile> outFile(TFile::Open(outputFilename, "RECREATE") );
-    auto lyso_est = make_unique<TTree>("lyso_est", "TTree of lyso estimators");
-
-    lyso_est->Branch("EventEstimators", &eventlyso_ptr);
-    
+
+    Int_t nThreads = 1;
+    Bool_t isOrdered = false;
+    OutputFormat outputFormat = OutputFormat::TTree;
+    Int_t readAhead = 8;
+    Int_t nReaders = 1;
+    Int_t nJobs = 1;
+    Bool_t isForced = false;
+    Long64_t firstEntry = 0;
+    Long64_t lastEntry = -1;
+    Int_t shard = 0;
+    Int_t nShards = 1;
+    Long64_t checkpointEntries = 0;
+    string cacheOutputFilename;
+    Int_t cacheCircles = -1;
+    string cacheInputFilename;
+    const char* scanFilename = nullptr;
+    string metricsPrefix;
+    Double_t metricsPeriod = 10.;
+    Bool_t isHwProfiled = false;
+    for(Int_t i = 3; i < argc; i++)
+    {
+        string arg = argv[i];
+        if(arg == "--threads" && i + 1 < argc)
+        {
+            nThreads = stoi(argv[++i]);
+        }
+        else if(arg == "--ordered")
+        {
+            isOrdered = true;
+        }
+        else if(arg == "--read-ahead" && i + 1 < argc)
+        {
+            readAhead = stoi(argv[++i]);
+        }
+        else if(arg == "--readers" && i + 1 < argc)
+        {
+            nReaders = stoi(argv[++i]);
+        }
+        else if(arg == "--jobs" && i + 1 < argc)
+        {
+            nJobs = stoi(argv[++i]);
+        }
+        else if(arg == "--first-entry" && i + 1 < argc)
+        {
+            firstEntry = stoll(argv[++i]);
+        }
+        else if(arg == "--last-entry" && i + 1 < argc)
+        {
+            lastEntry = stoll(argv[++i]);
+        }
+        else if(arg == "--shard" && i + 1 < argc)
+        {
+            if(sscanf(argv[++i], "%d/%d", &shard, &nShards) != 2 || nShards < 1 || shard < 0 || shard >= nShards)
+            {
+                cerr << "Shard not valid, expected i/N with 0 <= i < N: " << argv[i] << endl;
+                return 1;
+            }
+        }
+        else if(arg == "--checkpoint" && i + 1 < argc)
+        {
+            checkpointEntries = stoll(argv[++i]);
+        }
+        else if(arg == "--write-cache" && i + 1 < argc)
+        {
+            cacheOutputFilename = argv[++i];
+        }
+        else if(arg == "--cache-circles" && i + 1 < argc)
+        {
+            cacheCircles = stoi(argv[++i]);
+        }
+        else if(arg == "--from-cache" && i + 1 < argc)
+        {
+            cacheInputFilename = argv[++i];
+        }
+        else if(arg == "--scan" && i + 1 < argc)
+        {
+            scanFilename = argv[++i];
+        }
+        else if(arg == "--metrics" && i + 1 < argc)
+        {
+            metricsPrefix = argv[++i];
+        }
+        else if(arg == "--metrics-period" && i + 1 < argc)
+        {
+            metricsPeriod = stod(argv[++i]);
+        }
+        else if(arg == "--profile-hw")
+        {
+            isHwProfiled = true;
+        }
+        else if(arg == "--force")
+        {
+            isForced = true;
+        }
+        else if(arg == "--format" && i + 1 < argc)
+        {
+            if(!ParseOutputFormat(argv[++i], outputFormat))
+            {
+                cerr << "Unknown output format: " << argv[i] << endl;
+                return 1;
+            }
+        }
+        else
+        {
+            cerr << "Unknown option: " << arg << endl;
+            return 1;
+        }
+    }
+
     ConfigAnalyzer::GetInstance()->LoadConfig(configFilename);
-    for(Int_t k = 0; k < nEntries; k++)
+
+    OutputTier outputTier;
+    if(!ParseOutputTier(ConfigAnalyzer::GetInstance()->outputTier, outputTier))
+    {
+        cerr << "Unknown outputTier: " << ConfigAnalyzer::GetInstance()->outputTier << endl;
+        return 1;
+    }
+
+    // Configurations of the scan, on top of the config file
+    ScanLYSO scan;
+    if(scanFilename)
+    {
+        vector<ParametersLYSO> points;
+        if(!ScanLYSO::Parse(scanFilename, ParametersLYSO::FromConfig(), points))
+        {
+            cerr << "Scan not valid: " << scanFilename << endl;
+            return 1;
+        }
+        scan = ScanLYSO(points);
+    }
+
+    // Stage timings of all the runs, exported every metricsPeriod and at the end.
+    // The hardware profile alone is only printed
+    shared_ptr<MetricsLYSO> metrics;
+    if(!metricsPrefix.empty() || isHwProfiled)
+        metrics = make_shared<MetricsLYSO>(metricsPrefix, metricsPeriod, isHwProfiled);
+    auto finishMetrics = [&metrics, &metricsPrefix]()
     {
-        lyso_wfs->GetEntry(k);
+        if(!metrics)
+            return true;
+        Bool_t ok = metrics->Stop();
+        metrics->Print();
+        if(!metricsPrefix.empty())
+            cout << "AnalyzerWT>> Metrics written to " << metricsPrefix << ".json and " << metricsPrefix << ".prom" << endl;
+        return ok;
+    };
 
-        vector<RVecD> fFront_data(fFront->begin(), fFront->end());
-        vector<RVecD> fBack_data(fBack->begin(), fBack->end());
+    auto options = [=](LoopAnalyzer& loop)
+    {
+        loop.SetThreads(nThreads);
+        loop.SetOrdered(isOrdered);
+        loop.SetOutputFormat(outputFormat);
+        loop.SetOutputTier(outputTier);
+        loop.SetReadAhead(readAhead, nReaders);
+        loop.SetCheckpoint(checkpointEntries);
+        loop.SetScan(scan);
+        loop.SetMetrics(metrics);
+    };
+    if(metrics)
+        metrics->Start();
+
+    // Batch mode for lists, directories and globs
+    vector<string> barFilenames = BatchAnalyzer::ExpandInputs(barFilename);
+    if(barFilenames.size() != 1 || barFilenames[0] != barFilename)
+    {
+        if(barFilenames.empty())
+        {
+            cerr << "No bar files in: " << barFilename << endl;
+            return 1;
+        }
+
+        if(nShards > 1 || firstEntry > 0 || lastEntry >= 0)
+        {
+            cerr << "Entry ranges and shards need a single bar file" << endl;
+            return 1;
+        }
+        if(!cacheOutputFilename.empty() || !cacheInputFilename.empty())
+        {
+            cerr << "Channel caches need a single bar file" << endl;
+            return 1;
+        }
 
-        eventlyso = make_unique<EventLYSO>(fEvent, fTime_F_data, fTime_B_data, fFront_data, fBack_data);
-        eventlyso->CalculateEstimatorsForEveryMPPC();
-        eventlyso->MeasureDetectorCharge();
-        eventlyso->MeasureDetectorTime();
-        eventlyso->MeasureDetectorPosition();
+        BatchAnalyzer batch(barFilenames, configFilename);
+        batch.SetJobs(nJobs);
+        batch.SetForce(isForced);
+        batch.SetLoopOptions(options);
+        batch.SetScan(scan);
 
-        eventlyso_ptr = eventlyso.get();
-        lyso_est->Fill();
+        Bool_t ok = batch.Run();
+        ok = finishMetrics() && ok;
 
-        if(nEntries < 10 || k % (nEntries / 10) == 0)
-            cout << "\rAnalyzerWT>> Processed " << k + 1 << " events" << flush;
+        return ok ? 0 : 1;
     }
-    cout << endl;
 
-    outFile->cd();
-    outFile->WriteObject(lyso_est.get(), "lyso_est");
+    string outputFilename = GenerateOutputFilename(barFilename);
+    if(outputFilename.empty())
+        return 1;
+
+    // Shard-tagged outputs, merged back by merge_lyso
+    string tag;
+    if(nShards > 1)
+        tag = ShardTag(shard, nShards);
+    else if(firstEntry > 0 || lastEntry >= 0)
+        tag = EntryRangeTag(firstEntry, lastEntry);
+    if(!tag.empty())
+    {
+        outputFilename = ShardFilename(outputFilename, tag);
+        if(!cacheOutputFilename.empty())
+            cacheOutputFilename = ShardFilename(cacheOutputFilename, tag);
+    }
+
+    LoopAnalyzer loop(barFilename, outputFilename.c_str());
+    options(loop);
+    if(!cacheOutputFilename.empty())
+        loop.SetChannelCacheOutput(cacheOutputFilename, cacheCircles);
+    // Global stage only: the bar file just names the output
+    if(!cacheInputFilename.empty())
+        loop.SetChannelCacheInput(cacheInputFilename);
+    loop.SetEntryRange(firstEntry, lastEntry);
+    loop.SetShard(shard, nShards);
 
-    delete lyso_wfs_times;
-    delete lyso_wfs;
-    delete fTime_F;
-    delete fTime_B;
-    delete fFront;
-    delete fBack;
+    Bool_t ok = loop.Run();
+    ok = finishMetrics() && ok;
+    if(!ok)
+        return 1;
 
     // Finally
     return 0;
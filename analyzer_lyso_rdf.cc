@@ -0,0 +1,109 @@
+//****************************************************************************//
+//                                                                            //
+//        RDataFrame driver of the 'Analyzer' for the LYSO prototype          //
+//                                                                            //
+//****************************************************************************//
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include <TROOT.h>
+#include <ROOT/RDataFrame.hxx>
+#include <ROOT/RVec.hxx>
+
+#include "globals.hh"
+#include "configure.hh"
+#include "inputlyso.hh"
+#include "analysislyso.hh"
+
+using namespace std;
+using namespace ROOT;
+
+
+
+
+int main(int argc, char** argv)
+{
+    if(argc < 4)
+    {
+        cerr << "Usage: " << argv[0] << " <barFilename> <configFilename> <outputFilename> [--threads N]" << endl;
+        return 1;
+    }
+
+    const char *barFilename = argv[1];
+    const char *configFilename = argv[2];
+    const char *outputFilename = argv[3];
+
+    // 0 = all the cores
+    Int_t nThreads = 1;
+    for(Int_t i = 4; i < argc; i++)
+    {
+        string arg = argv[i];
+        if(arg == "--threads" && i + 1 < argc)
+        {
+            nThreads = stoi(argv[++i]);
+        }
+        else
+        {
+            cerr << "Unknown option: " << arg << endl;
+            return 1;
+        }
+    }
+
+    ConfigAnalyzer::GetInstance()->LoadConfig(configFilename);
+
+    OutputTier outputTier;
+    if(!ParseOutputTier(ConfigAnalyzer::GetInstance()->outputTier, outputTier))
+    {
+        cerr << "Unknown outputTier: " << ConfigAnalyzer::GetInstance()->outputTier << endl;
+        return 1;
+    }
+
+    if(nThreads != 1)
+        EnableImplicitMT(nThreads > 0 ? nThreads : 0);
+
+    // Time calibration from lyso_wfs_times
+    shared_ptr<TimeCalibrationLYSO> calibration;
+    Bool_t hasStopCells;
+    {
+        InputLYSO input(barFilename);
+        if(!input.IsValid())
+            return 1;
+        calibration = input.GetCalibration();
+        hasStopCells = input.HasStopCells();
+    }
+
+    AnalysisLYSO analysis(calibration);
+    RDataFrame df("lyso_wfs", barFilename);
+    RDF::RNode node = df;
+
+    if(hasStopCells)
+    {
+        node = node.Define("lyso", [analysis](Int_t event, const vector<RVecF>& front, const vector<RVecF>& back, const vector<Int_t>& stopCells_F, const vector<Int_t>& stopCells_B)
+        {
+            return analysis.Analyze(event, front, back, &stopCells_F, &stopCells_B);
+        }, {"Event", "Front", "Back", "StopCell_F", "StopCell_B"});
+    }
+    else
+    {
+        node = node.Define("lyso", analysis, {"Event", "Front", "Back"});
+    }
+
+    // Own cuts and histograms can be booked on node here, they run in the same pass
+    vector<string> columns;
+    node = AnalysisLYSO::DefineColumns(node, outputTier, columns);
+
+    cout << "AnalyzerRDF>> Threads = " << (nThreads == 1 ? 1 : GetThreadPoolSize()) << ", " << GetOutputTierName(outputTier) << " tier" << endl;
+
+    auto start = chrono::steady_clock::now();
+    node.Snapshot("lyso_est", outputFilename, columns);
+    chrono::duration<Double_t> elapsed = chrono::steady_clock::now() - start;
+
+    cout << "AnalyzerRDF>> Done in " << elapsed.count() << " s" << endl;
+
+    // Finally
+    return 0;
+}
@@ -0,0 +1,523 @@
+//****************************************************************************//
+//                                                                            //
+//        Benchmarks of the waveform and event kernels of 'Analyzer'          //
+//                                                                            //
+//****************************************************************************//
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <ctime>
+#include <functional>
+#include <algorithm>
+#include <cstdlib>
+
+#include <TSystem.h>
+#include <TMath.h>
+#include <RVersion.h>
+#include <ROOT/RVec.hxx>
+
+#include "globals.hh"
+#include "configure.hh"
+#include "wavedrs.hh"
+#include "waveformmppc.hh"
+#include "eventlyso.hh"
+#include "geometrylyso.hh"
+#include "simdmppc.hh"
+#include "timecalibrationlyso.hh"
+#include "loopanalyzer.hh"
+#include "generatorlyso.hh"
+
+using namespace std;
+using namespace ROOT;
+
+
+namespace
+{
+    //------------------------------------------------------------------------//
+    // Timing
+    //------------------------------------------------------------------------//
+
+    // The compiler can't drop the computation of x
+    template<class T>
+    inline void KeepAlive(const T& x)
+    {
+        asm volatile("" : : "g"(&x) : "memory");
+    }
+
+
+
+    struct BenchResult
+    {
+        string name;
+        Long64_t iterations;      // per repetition
+        Double_t items;           // per iteration (waveforms, events, ...)
+        vector<Double_t> seconds; // per iteration, one per repetition
+    };
+
+
+
+    class BenchRunner
+    {
+      public:
+        BenchRunner(Int_t repetitions, Double_t minTime, const string& filter)
+            : fRepetitions(repetitions), fMinTime(minTime), fFilter(filter) {}
+
+        inline void SetSuffix(const string& suffix) { fSuffix = suffix; }
+        inline const vector<BenchResult>& GetResults() const { return fResults; }
+        inline Bool_t IsSelected(const string& name) const { return fFilter.empty() || name.find(fFilter) != string::npos; }
+
+        // body() is one iteration. Iterations per repetition are doubled up
+        // to fMinTime, then every repetition times them all
+        void Run(const string& name, Double_t items, const function<void()>& body)
+        {
+            if(!IsSelected(name))
+                return;
+
+            auto time = [&body](Long64_t n)
+            {
+                auto start = chrono::steady_clock::now();
+                for(Long64_t i = 0; i < n; i++)
+                    body();
+                return chrono::duration<Double_t>(chrono::steady_clock::now() - start).count();
+            };
+
+            Long64_t n = 1;
+            Double_t elapsed = time(n);
+            while(elapsed < fMinTime && n < (1LL << 40))
+            {
+                n = elapsed > 0 ? TMath::Max(2*n, Long64_t(1.2*fMinTime/elapsed*n)) : 2*n;
+                elapsed = time(n);
+            }
+
+            BenchResult result{name + fSuffix, n, items, {}};
+            for(Int_t r = 0; r < fRepetitions; r++)
+                result.seconds.push_back(time(n) / n);
+            Report(result);
+        }
+
+        // run() is one repetition, returns its seconds (e.g. a whole file)
+        void RunRepetitions(const string& name, Double_t items, Int_t repetitions, const function<Double_t()>& run)
+        {
+            if(!IsSelected(name))
+                return;
+
+            BenchResult result{name + fSuffix, 1, items, {}};
+            for(Int_t r = 0; r < repetitions; r++)
+                result.seconds.push_back(run());
+            Report(result);
+        }
+
+      private:
+        void Report(const BenchResult& result)
+        {
+            Double_t mean = TMath::Mean(result.seconds.begin(), result.seconds.end());
+            cerr << "BenchLYSO>> " << result.name << ": " << mean*1e9 << " ns";
+            if(result.items > 1)
+                cerr << ", " << result.items/mean << " items/s";
+            cerr << endl;
+            fResults.push_back(result);
+        }
+
+        Int_t fRepetitions;
+        Double_t fMinTime;
+        string fFilter;
+        string fSuffix;
+        vector<BenchResult> fResults;
+    };
+
+
+
+    //------------------------------------------------------------------------//
+    // Benchmarks
+    //------------------------------------------------------------------------//
+    void BenchWaveforms(BenchRunner& runner, const GeneratorLYSO& generator, const GeneratedEventLYSO& event)
+    {
+        // Channel of max amplitude of the front face: triggered
+        Int_t ch = 0;
+        for(Int_t i = 0; i < CHANNELS; i++)
+        {
+            if(Min(event.volts_F[i]) < Min(event.volts_F[ch]))
+                ch = i;
+        }
+        const RVecF& t = generator.GetTimes_F()[ch];
+        const RVecF& v = event.volts_F[ch];
+
+        WaveformMPPC wave(ch, t, v);
+        wave.MeasureBaseline();
+        wave.MeasureAmplitude();
+
+        runner.Run("WaveformMPPC::MeasureBaseline", 1, [&wave]() { wave.MeasureBaseline(); KeepAlive(wave); });
+        runner.Run("WaveformMPPC::MeasureCharge", 1, [&wave]() { wave.MeasureCharge(); KeepAlive(wave); });
+        runner.Run("WaveformMPPC::MeasureAmplitude", 1, [&wave]() { wave.MeasureAmplitude(); KeepAlive(wave); });
+        runner.Run("WaveformMPPC::MeasureTimeCF/15", 1, [&wave]() { wave.MeasureTimeCF(0.15, 15); KeepAlive(wave); });
+        runner.Run("WaveformMPPC::MeasureTimeCF/50", 1, [&wave]() { wave.MeasureTimeCF(0.50, 50); KeepAlive(wave); });
+        const ParametersMPPC par = ParametersMPPC::FromConfig();
+        runner.Run("WaveformMPPC::MeasureTimesCF/default", 1, [&wave, &par]() { wave.MeasureTimesCF<DefaultFractionsMPPC>(par); KeepAlive(wave); });
+
+        // CrossingPoint is private: the kernels it runs, trigger cell search
+        Double_t trgValue = wave.GetBaseline() + ConfigAnalyzer::GetInstance()->trgLevel;
+        runner.Run("CrossingPoint/float", 1, [&v, trgValue]()
+        {
+            Int_t bin = FindCrossingMPPC(v.data(), trgValue, false, ZERO_TIME_BIN, SAMPLINGS - 1);
+            KeepAlive(bin);
+        });
+        RVecD vd(v.begin(), v.end());
+        runner.Run("CrossingPoint/double", 1, [&vd, trgValue]()
+        {
+            Int_t bin = FindCrossingMPPC(vd.data(), trgValue, false, ZERO_TIME_BIN, SAMPLINGS - 1);
+            KeepAlive(bin);
+        });
+
+        // Same time base (plain add) and half a sample apart (interpolation)
+        WaveDRS a(RVecD(t.begin(), t.end()), RVecD(v.begin(), v.end()));
+        WaveDRS b = a;
+        runner.Run("WaveDRS::operator+=/same-times", 1, [&a, &b]() { a += b; KeepAlive(a); });
+
+        WaveDRS c = a;
+        for(auto& time : c.times)
+            time += 0.5*generator.GetParameters().samplingPeriod;
+        const RVecD timesA = a.times;
+        // The times of the sum move to the mean ones: restored every time
+        runner.Run("WaveDRS::operator+=/interpolated", 1, [&a, &c, &timesA]()
+        {
+            copy(timesA.begin(), timesA.end(), a.times.begin());
+            a += c;
+            KeepAlive(a);
+        });
+    }
+
+
+
+    void BenchGeometry(BenchRunner& runner, EventLYSO& event)
+    {
+        const GeometryLYSO* geometry = GeometryLYSO::GetInstance();
+        for(Int_t nCircles : {1, 3})
+        {
+            runner.Run("FindFirstNeighbors/" + to_string(nCircles), CHANNELS, [geometry, nCircles]()
+            {
+                Int_t total = 0;
+                for(Int_t ch = 0; ch < CHANNELS; ch++)
+                {
+                    Int_t size;
+                    geometry->GetNeighbors(ch, nCircles, size);
+                    total += size;
+                }
+                KeepAlive(total);
+            });
+        }
+
+        runner.Run("EventLYSO::GetCentroidX", 1, [&event]() { Double_t x = event.GetCentroidX("F", 1); KeepAlive(x); });
+        runner.Run("EventLYSO::GetCentroidY", 1, [&event]() { Double_t y = event.GetCentroidY("F", 1); KeepAlive(y); });
+        runner.Run("EventLYSO::GetCentroidStdDev", 1, [&event]() { auto s = event.GetCentroidStdDev("F", 1); KeepAlive(s); });
+    }
+
+
+
+    void BenchEvents(BenchRunner& runner, const GeneratorLYSO& generator, const vector<GeneratedEventLYSO>& events)
+    {
+        TimeCalibrationLYSO& calibration = *generator.GetCalibration();
+        const Float_t* grids[FACES*CHANNELS];
+        for(Int_t face = 0; face < FACES; face++)
+        {
+            for(Int_t ch = 0; ch < CHANNELS; ch++)
+                grids[face*CHANNELS + ch] = calibration.GetTimes(face, ch);
+        }
+
+        const GeneratedEventLYSO& first = events[0];
+        EventLYSO event(0, grids, first.volts_F, first.volts_B);
+        event.CalculateEstimatorsForEveryMPPC();
+
+        runner.Run("EventLYSO::CalculateEstimatorsForEveryMPPC", 2*CHANNELS, [&event]() { event.CalculateEstimatorsForEveryMPPC(); });
+        runner.Run("EventLYSO::MeasureDetectorCharge", 1, [&event]() { event.MeasureDetectorCharge(); });
+        runner.Run("EventLYSO::MeasureDetectorTime", 1, [&event]() { event.MeasureDetectorTime(); });
+        runner.Run("EventLYSO::MeasureDetectorPosition", 1, [&event]() { event.MeasureDetectorPosition(); });
+
+        // Per-channel kernels with the windows and fractions as constants and as parameters
+        const ParametersMPPC par = ParametersMPPC::FromConfig();
+        EstimatorsMPPC est[FACES*CHANNELS];
+        auto windows = [&event, &par, &est](const auto& shape)
+        {
+            for(Int_t i = 0; i < FACES*CHANNELS; i++)
+            {
+                MeasureWindowsMPPC(event.GetTimes(i/CHANNELS, i%CHANNELS), event.GetSamples(i/CHANNELS, i%CHANNELS), par, shape, est[i]);
+                MeasureTimesCFMPPC(event.GetTimes(i/CHANNELS, i%CHANNELS), event.GetSamples(i/CHANNELS, i%CHANNELS), par, shape, est[i]);
+            }
+            KeepAlive(est);
+        };
+        if(DefaultShapeMPPC::Matches(par))
+            runner.Run("MeasureEstimatorsMPPC/fixed-shape", 2*CHANNELS, [&windows]() { windows(DefaultShapeMPPC()); });
+        runner.Run("MeasureEstimatorsMPPC/dynamic-shape", 2*CHANNELS, [&windows, &par]() { windows(DynamicShapeMPPC{par}); });
+
+        BenchGeometry(runner, event);
+
+        // Whole event as in LoopAnalyzer: packing and the four stages on the same event, over different entries
+        size_t k = 0;
+        EventLYSO eventlyso;
+        runner.Run("EventLYSO/pipeline", 1, [&events, &grids, &k, &eventlyso]()
+        {
+            const GeneratedEventLYSO& e = events[k % events.size()];
+            eventlyso.Load(k++, grids, e.volts_F, e.volts_B);
+            eventlyso.CalculateEstimatorsForEveryMPPC();
+            eventlyso.MeasureDetectorCharge();
+            eventlyso.MeasureDetectorTime();
+            eventlyso.MeasureDetectorPosition();
+            KeepAlive(eventlyso);
+        });
+    }
+
+
+
+    void BenchEndToEnd(BenchRunner& runner, const string& dir, Long64_t nEvents, Int_t nThreads, Int_t repetitions)
+    {
+        string name = "LoopAnalyzer/events-" + to_string(nEvents) + "/threads-" + to_string(nThreads);
+        if(!runner.IsSelected(name))
+            return;
+
+        string barFilename = dir + "/BarID_0_bench" + to_string(nEvents) + ".root";
+        string outputFilename = dir + "/Analyzed_bench.root";
+        if(gSystem->AccessPathName(barFilename.c_str()))
+        {
+            cerr << "BenchLYSO>> Generating " << nEvents << " events in " << barFilename << endl;
+            GeneratorParameters par;
+            par.nEvents = nEvents;
+            if(!GeneratorLYSO(par).Write(barFilename, thread::hardware_concurrency()))
+                return;
+        }
+
+        auto run = [&]()
+        {
+            LoopAnalyzer loop(barFilename.c_str(), outputFilename.c_str());
+            loop.SetThreads(nThreads);
+            loop.SetVerbose(false);
+
+            auto start = chrono::steady_clock::now();
+            loop.Run();
+            return chrono::duration<Double_t>(chrono::steady_clock::now() - start).count();
+        };
+
+        // Warm-up: page cache, time grids, first allocations
+        run();
+        runner.RunRepetitions(name, nEvents, repetitions, [&run, nEvents]() { return run() / nEvents; });
+        gSystem->Unlink(outputFilename.c_str());
+    }
+
+
+
+    //------------------------------------------------------------------------//
+    // JSON report
+    //------------------------------------------------------------------------//
+    string Escape(const string& s)
+    {
+        string out;
+        for(char c : s)
+        {
+            if(c == '"' || c == '\\')
+                out += '\\';
+            out += c;
+        }
+        return out;
+    }
+
+
+
+    void WriteJSON(ostream& out, const vector<BenchResult>& results, Int_t repetitions, Double_t minTime)
+    {
+        char date[32];
+        time_t now = time(nullptr);
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+        out.precision(10);
+        out << "{" << endl;
+        out << "  \"context\": {" << endl;
+        out << "    \"date\": \"" << date << "\"," << endl;
+        out << "    \"host\": \"" << Escape(gSystem->HostName()) << "\"," << endl;
+        out << "    \"num_cpus\": " << thread::hardware_concurrency() << "," << endl;
+        out << "    \"root_version\": \"" << ROOT_RELEASE << "\"," << endl;
+#ifdef __VERSION__
+        out << "    \"compiler\": \"" << Escape(__VERSION__) << "\"," << endl;
+#endif
+#ifdef NDEBUG
+        out << "    \"build_type\": \"release\"," << endl;
+#else
+        out << "    \"build_type\": \"debug\"," << endl;
+#endif
+        out << "    \"simd_detected\": \"" << GetSimdLevelName(GetSimdLevel()) << "\"," << endl;
+        out << "    \"repetitions\": " << repetitions << "," << endl;
+        out << "    \"min_time\": " << minTime << endl;
+        out << "  }," << endl;
+
+        out << "  \"benchmarks\": [" << endl;
+        for(size_t i = 0; i < results.size(); i++)
+        {
+            const BenchResult& r = results[i];
+            vector<Double_t> ns;
+            for(auto s : r.seconds)
+                ns.push_back(s*1e9);
+            Double_t mean = TMath::Mean(ns.begin(), ns.end());
+            Double_t stddev = ns.size() > 1 ? TMath::StdDev(ns.begin(), ns.end()) : 0.;
+
+            out << "    {" << endl;
+            out << "      \"name\": \"" << Escape(r.name) << "\"," << endl;
+            out << "      \"iterations\": " << r.iterations << "," << endl;
+            out << "      \"repetitions\": " << ns.size() << "," << endl;
+            out << "      \"time_unit\": \"ns\"," << endl;
+            out << "      \"mean\": " << mean << "," << endl;
+            out << "      \"median\": " << TMath::Median(ns.size(), ns.data()) << "," << endl;
+            out << "      \"stddev\": " << stddev << "," << endl;
+            out << "      \"variance\": " << stddev*stddev << "," << endl;
+            out << "      \"cv\": " << (mean > 0 ? stddev/mean : 0.) << "," << endl;
+            out << "      \"min\": " << *min_element(ns.begin(), ns.end()) << "," << endl;
+            out << "      \"max\": " << *max_element(ns.begin(), ns.end()) << "," << endl;
+            out << "      \"items_per_iteration\": " << r.items << "," << endl;
+            out << "      \"items_per_second\": " << (mean > 0 ? r.items/mean*1e9 : 0.) << "," << endl;
+            out << "      \"samples\": [";
+            for(size_t j = 0; j < ns.size(); j++)
+                out << (j ? ", " : "") << ns[j];
+            out << "]" << endl;
+            out << "    }" << (i + 1 < results.size() ? "," : "") << endl;
+        }
+        out << "  ]" << endl;
+        out << "}" << endl;
+    }
+}
+
+
+
+
+int main(int argc, char** argv)
+{
+    Int_t repetitions = 10;
+    Double_t minTime = 0.1;
+    string filter;
+    string jsonFilename;
+    string configFilename;
+    string dir;
+    vector<SimdLevel> levels = {GetSimdLevel()};
+    Long64_t nEvents = 2000;
+    Int_t nThreads = 1;
+    Int_t e2eRepetitions = 3;
+
+    for(Int_t i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if(arg == "--repetitions" && i + 1 < argc)
+        {
+            repetitions = TMath::Max(stoi(argv[++i]), 1);
+        }
+        else if(arg == "--min-time" && i + 1 < argc)
+        {
+            minTime = stod(argv[++i]);
+        }
+        else if(arg == "--filter" && i + 1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else if(arg == "--json" && i + 1 < argc)
+        {
+            jsonFilename = argv[++i];
+        }
+        else if(arg == "--config" && i + 1 < argc)
+        {
+            configFilename = argv[++i];
+        }
+        else if(arg == "--dir" && i + 1 < argc)
+        {
+            dir = argv[++i];
+        }
+        else if(arg == "--simd" && i + 1 < argc)
+        {
+            // Comma-separated: the suite runs at every level
+            levels.clear();
+            istringstream list(argv[++i]);
+            string name;
+            while(getline(list, name, ','))
+            {
+                SimdLevel level;
+                if(!ParseSimdLevel(name.c_str(), level))
+                {
+                    cerr << "Unknown SIMD level: " << name << endl;
+                    return 1;
+                }
+                levels.push_back(level);
+            }
+        }
+        else if(arg == "--events" && i + 1 < argc)
+        {
+            nEvents = stoll(argv[++i]);
+        }
+        else if(arg == "--threads" && i + 1 < argc)
+        {
+            nThreads = stoi(argv[++i]);
+        }
+        else if(arg == "--e2e-repetitions" && i + 1 < argc)
+        {
+            e2eRepetitions = TMath::Max(stoi(argv[++i]), 1);
+        }
+        else
+        {
+            cerr << "Usage: " << argv[0] << " [--repetitions R] [--min-time S] [--filter NAME] [--json FILE] [--config analyze.mac]"
+                 << " [--simd scalar,sse4.2,avx2,avx512] [--events N] [--threads N] [--e2e-repetitions R] [--dir DIR]" << endl;
+            return 1;
+        }
+    }
+
+    // analyze.mac defaults, or the given config
+    auto config = ConfigAnalyzer::GetInstance();
+    config->trgLevel = -0.050;
+    config->lowBase = 100;
+    config->upBase = 300;
+    config->lowInt = 400;
+    config->upInt = 1000;
+    config->nCircles_Time = 1;
+    config->nCircles_Position = 1;
+    config->outputTier = "full";
+    if(!configFilename.empty())
+        config->LoadConfig(configFilename.c_str());
+
+    // Generated input and outputs of the end-to-end benchmark
+    Bool_t isTempDir = dir.empty();
+    if(isTempDir)
+        dir = string(gSystem->TempDirectory()) + "/bench_lyso_" + to_string(gSystem->GetPid());
+    gSystem->mkdir(dir.c_str(), true);
+
+    GeneratorLYSO generator;
+    vector<GeneratedEventLYSO> events(16);
+    for(size_t k = 0; k < events.size(); k++)
+        generator.Generate(k, events[k]);
+
+    BenchRunner runner(repetitions, minTime, filter);
+    for(SimdLevel level : levels)
+    {
+        SetSimdLevel(level);
+        if(levels.size() > 1)
+            runner.SetSuffix(string("[") + GetSimdLevelName(GetSimdLevel()) + "]");
+
+        BenchWaveforms(runner, generator, events[0]);
+        BenchEvents(runner, generator, events);
+        BenchEndToEnd(runner, dir, nEvents, nThreads, e2eRepetitions);
+    }
+
+    if(jsonFilename.empty())
+    {
+        WriteJSON(cout, runner.GetResults(), repetitions, minTime);
+    }
+    else
+    {
+        ofstream json(jsonFilename);
+        WriteJSON(json, runner.GetResults(), repetitions, minTime);
+    }
+
+    if(isTempDir)
+    {
+        gSystem->Unlink((dir + "/BarID_0_bench" + to_string(nEvents) + ".root").c_str());
+        gSystem->Unlink(dir.c_str());
+    }
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+//****************************************************************************//
+//                                                                            //
+//          Synthetic BarID files for the scaling tests of 'Analyzer'         //
+//                                                                            //
+//****************************************************************************//
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <thread>
+
+#include <TSystem.h>
+
+#include "generatorlyso.hh"
+
+using namespace std;
+
+
+
+
+int main(int argc, char** argv)
+{
+    if(argc < 2 || string(argv[1]).rfind("--", 0) == 0)
+    {
+        cerr << "Usage: " << argv[0] << " <outputFilename> [--threads N] [--events N] [--seed S] [--compression C]" << endl
+             << "       [--sampling NS] [--cell-jitter F] [--stop-cells 0|1] [--rise NS] [--decay NS] [--pulse-time NS] [--time-jitter NS]" << endl
+             << "       [--amplitude V] [--amplitude-spread F] [--light-spread MM] [--back-ratio F] [--hit uniform|x,y[,sigma]]" << endl
+             << "       [--noise V] [--baseline V] [--pile-up MEAN]" << endl;
+        return 1;
+    }
+
+    string outputFilename = argv[1];
+    Int_t nThreads = thread::hardware_concurrency();
+    GeneratorParameters par;
+    for(Int_t i = 2; i < argc; i++)
+    {
+        string arg = argv[i];
+        if(arg.rfind("--", 0) != 0 || i + 1 >= argc)
+        {
+            cerr << "Option not valid: " << arg << endl;
+            return 1;
+        }
+        string name = arg.substr(2);
+        string value = argv[++i];
+        if(name == "threads")
+        {
+            nThreads = stoi(value);
+        }
+        else if(!par.Set(name, value))
+        {
+            cerr << "Option not valid: " << arg << " " << value << endl;
+            return 1;
+        }
+    }
+    nThreads = max(nThreads, 1);
+
+    cout << "GenerateLYSO>> " << par.nEvents << " events into " << outputFilename << " with " << nThreads << " threads" << endl;
+    cout << par.ToString();
+
+    auto start = chrono::steady_clock::now();
+    GeneratorLYSO generator(par);
+    if(!generator.Write(outputFilename, nThreads))
+        return 1;
+    Double_t seconds = chrono::duration<Double_t>(chrono::steady_clock::now() - start).count();
+
+    FileStat_t stat;
+    gSystem->GetPathInfo(outputFilename.c_str(), stat);
+    cout << "GenerateLYSO>> Done in " << seconds << " s: " << par.nEvents/seconds << " events/s, "
+         << stat.fSize/1048576. << " MB (" << stat.fSize/1048576./seconds << " MB/s)" << endl;
+
+    // Finally
+    return 0;
+}
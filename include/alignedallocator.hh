@@ -0,0 +1,43 @@
+#ifndef ALIGNEDALLOCATOR_HH
+#define ALIGNEDALLOCATOR_HH
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+
+// Minimal allocator for cache-line (and SIMD register) aligned buffers
+template<typename T, std::size_t Alignment = 64>
+struct AlignedAllocator
+{
+    using value_type = T;
+
+    template<typename U>
+    struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+    AlignedAllocator() = default;
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(::operator new(n*sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* p, std::size_t)
+    {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template<typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+    template<typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+
+template<typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+
+#endif // ALIGNEDALLOCATOR_HH
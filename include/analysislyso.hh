@@ -0,0 +1,60 @@
+#ifndef ANALYSISLYSO_HH
+#define ANALYSISLYSO_HH
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <ROOT/RVec.hxx>
+#include <ROOT/RDataFrame.hxx>
+
+#include "globals.hh"
+#include "eventlyso.hh"
+#include "estimatorsmppc.hh"
+#include "timecalibrationlyso.hh"
+#include "outputlyso.hh"
+
+
+// Analysis of lyso_wfs events as RDataFrame::Define functions. Thread-safe:
+// every call works on its own EventLYSO, parameters are copied at
+// construction and the time grids are shared
+class AnalysisLYSO
+{
+  public:
+    using EventPtr = std::shared_ptr<const EventLYSO>;
+
+    AnalysisLYSO(std::shared_ptr<TimeCalibrationLYSO> calibration,
+                 const ParametersMPPC& par = ParametersMPPC::FromConfig(),
+                 Int_t nCircles_Time = ConfigAnalyzer::GetInstance()->nCircles_Time,
+                 Int_t nCircles_Position = ConfigAnalyzer::GetInstance()->nCircles_Position);
+
+    // Per-channel and global estimators of one event:
+    // df.Define("lyso", analysis, {"Event", "Front", "Back"})
+    EventPtr operator()(Int_t event, const std::vector<ROOT::RVecF>& front, const std::vector<ROOT::RVecF>& back) const;
+    // Same, with the StopCell_F/StopCell_B columns
+    EventPtr Analyze(Int_t event, const std::vector<ROOT::RVecF>& front, const std::vector<ROOT::RVecF>& back,
+                     const std::vector<Int_t>* stopCells_F = nullptr, const std::vector<Int_t>* stopCells_B = nullptr) const;
+    // Per-channel estimators only
+    EventPtr AnalyzeChannels(Int_t event, const std::vector<ROOT::RVecF>& front, const std::vector<ROOT::RVecF>& back,
+                             const std::vector<Int_t>* stopCells_F = nullptr, const std::vector<Int_t>* stopCells_B = nullptr) const;
+
+    // Flat columns of the tier (same names as lyso_est, nTrg_* included) from
+    // the EventPtr column eventColumn. Their names are appended to columns,
+    // e.g. for Snapshot. Time*_* (5) and Centroid_* (4) are RVecD: Snapshot
+    // writes them as variable-length arrays, not as the fixed [5]/[4] leaves
+    // of analyzer_lyso
+    static ROOT::RDF::RNode DefineColumns(ROOT::RDF::RNode df, OutputTier tier, std::vector<std::string>& columns, const std::string& eventColumn = "lyso");
+
+  private:
+    std::shared_ptr<EventLYSO> CreateEvent(Int_t event, const std::vector<ROOT::RVecF>& front, const std::vector<ROOT::RVecF>& back,
+                                           const std::vector<Int_t>* stopCells_F, const std::vector<Int_t>* stopCells_B) const;
+
+    std::shared_ptr<TimeCalibrationLYSO> fCalibration;
+    ParametersMPPC fPar;
+    Int_t fCircles_Time;
+    Int_t fCircles_Position;
+};
+
+
+#endif // ANALYSISLYSO_HH
@@ -0,0 +1,85 @@
+#ifndef ARENALYSO_HH
+#define ARENALYSO_HH
+
+#include <vector>
+#include <type_traits>
+
+#include <Rtypes.h>
+
+#include "alignedallocator.hh"
+
+
+// Bump allocator of the scratch of the event analysis, one per thread.
+// Memory comes in 64-byte aligned blocks and is given back only by Rewind;
+// back to empty the blocks are merged into one, so after the first events
+// the analysis of a thread doesn't touch the heap anymore
+class ArenaLYSO
+{
+  public:
+    static constexpr size_t ALIGNMENT = 64;
+    static constexpr size_t MIN_BLOCK = 64*1024;
+
+    struct Mark
+    {
+        size_t block;
+        size_t offset;
+    };
+
+    // Rewinds the arena of the calling thread at the end of the scope
+    class Scope
+    {
+      public:
+        Scope() : fArena(GetThread()), fMark(fArena.GetMark()) {}
+        ~Scope() { fArena.Rewind(fMark); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        template<typename T>
+        inline T* Allocate(size_t n) { return fArena.Allocate<T>(n); }
+
+      private:
+        ArenaLYSO& fArena;
+        Mark fMark;
+    };
+
+    ArenaLYSO() = default;
+    ArenaLYSO(const ArenaLYSO&) = delete;
+    ArenaLYSO& operator=(const ArenaLYSO&) = delete;
+
+    // Arena of the calling thread
+    static ArenaLYSO& GetThread();
+
+    // n uninitialized elements, valid until the arena is rewound past them.
+    // No destructors are run: trivial types only
+    template<typename T>
+    inline T* Allocate(size_t n)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "ArenaLYSO doesn't run destructors");
+        size_t bytes = (n*sizeof(T) + ALIGNMENT - 1)/ALIGNMENT*ALIGNMENT;
+        if(fBlocks.empty() || fOffset + bytes > fBlocks[fBlock].size())
+            NextBlock(bytes);
+
+        T* p = reinterpret_cast<T*>(fBlocks[fBlock].data() + fOffset);
+        fOffset += bytes;
+        return p;
+    }
+
+    inline Mark GetMark() const { return {fBlock, fOffset}; }
+    // Frees everything allocated after mark
+    void Rewind(const Mark& mark);
+
+    size_t GetCapacity() const;
+    // Blocks taken from the heap so far
+    inline ULong64_t GetGrowths() const { return nGrowths; }
+
+  private:
+    void NextBlock(size_t bytes);
+
+    std::vector<AlignedVector<UChar_t>> fBlocks;
+    size_t fBlock = 0;
+    size_t fOffset = 0;
+    ULong64_t nGrowths = 0;
+};
+
+
+#endif // ARENALYSO_HH
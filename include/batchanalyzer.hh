@@ -0,0 +1,65 @@
+#ifndef BATCHANALYZER_HH
+#define BATCHANALYZER_HH
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "loopanalyzer.hh"
+
+
+// Output file of a bar file, RootFiles/AnalyzerID_<id>[_t<n>].root. Empty if
+// the name is not BarID_<id>[_t<n>].root
+std::string GenerateOutputFilename(const std::string& barFilename);
+
+
+
+// Many bar files analyzed by a pool of jobs, largest file first
+class BatchAnalyzer
+{
+  public:
+    // Bar files of spec: a directory (its BarID_*.root), a glob pattern, a
+    // list file (one path per line, # for comments) or a single .root file
+    static std::vector<std::string> ExpandInputs(const std::string& spec);
+
+    BatchAnalyzer(const std::vector<std::string>& barFilenames, const char* configFilename);
+    ~BatchAnalyzer() = default;
+
+    // Options
+    inline void SetJobs(Int_t n) { nJobs = n > 0 ? n : 1; }
+    // Analyze also files whose output is newer than the file and the config
+    inline void SetForce(Bool_t force) { isForced = force; }
+    // Called on the LoopAnalyzer of every file
+    inline void SetLoopOptions(std::function<void(LoopAnalyzer&)> options) { loopOptions = std::move(options); }
+    // Scan set by the loop options: one output per configuration of every file
+    inline void SetScan(const ScanLYSO& s) { scan = s; }
+
+    // Returns false if any file failed
+    Bool_t Run();
+
+  private:
+    struct Job
+    {
+        std::string barFilename;
+        std::string outputFilename;
+        Long64_t size;
+        Long_t mtime;
+    };
+
+    // Outputs written for outputFilename, one per configuration with a scan
+    std::vector<std::string> GetOutputFilenames(const std::string& outputFilename) const;
+    Bool_t IsUpToDate(const Job& job) const;
+    // Written to a temporary file renamed at the end: an output is never partial
+    Bool_t RunJob(const Job& job, Bool_t isVerbose, Long64_t& nEntries);
+
+    std::vector<std::string> barFilenames;
+    std::string configFilename;
+    Int_t nJobs = 1;
+    Bool_t isForced = false;
+    std::function<void(LoopAnalyzer&)> loopOptions;
+    ScanLYSO scan;
+};
+
+
+#endif // BATCHANALYZER_HH
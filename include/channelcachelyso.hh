@@ -0,0 +1,85 @@
+#ifndef CHANNELCACHELYSO_HH
+#define CHANNELCACHELYSO_HH
+
+#include <iostream>
+#include <string>
+#include <memory>
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include "globals.hh"
+#include "eventlyso.hh"
+#include "outputlyso.hh"
+#include "timecalibrationlyso.hh"
+
+
+// Cache of the per-channel stage (CalculateEstimatorsForEveryMPPC), the input
+// of the global stage (MeasureDetectorCharge/Time/Position) without the bar
+// file. Every event keeps its per-channel estimators and baselines; for the
+// summed waveform of MeasureDetectorTime, also the waveforms and stop cells of
+// the channels within nCircles of the channel of max amplitude of each face.
+// Trees: lyso_channels, one entry per event, and lyso_channels_info, one
+// entry per written file (hash of ParametersMPPC, nCircles, time calibration)
+struct ChannelCacheBuffer;
+
+
+
+// Writer, one per file (per thread)
+class ChannelCacheFileLYSO : public OutputFileLYSO
+{
+  public:
+    // Returns nullptr on errors
+    static std::unique_ptr<ChannelCacheFileLYSO> Create(const std::string& filename, std::shared_ptr<TimeCalibrationLYSO> calibration,
+                                                        const ParametersMPPC& par, Int_t nCircles);
+    ~ChannelCacheFileLYSO() override = default;
+
+    // The events must come from grids of the calibration (e.g. InputLYSO, ReadAheadLYSO)
+    std::unique_ptr<OutputLYSO> CreateWriter() override;
+    Bool_t Close() override;
+
+  private:
+    ChannelCacheFileLYSO() = default;
+
+    std::unique_ptr<TFile> file;
+    std::shared_ptr<TimeCalibrationLYSO> calibration;
+    ULong64_t hash = 0;
+    Int_t nCircles = 0;
+};
+
+
+
+// Reader: the global stage on the cached events
+class ChannelCacheLYSO
+{
+  public:
+    ChannelCacheLYSO(const char* cacheFilename);
+    ~ChannelCacheLYSO();
+
+    inline Bool_t IsValid() const { return lyso_channels != nullptr; }
+    inline Long64_t GetEntries() const { return nEntries; }
+    // Identity of the cache file, kept by its copies
+    inline std::string GetUUID() const { return cacheFile->GetUUID().AsString(); }
+    // ParametersMPPC::GetHash of the per-channel stage
+    inline ULong64_t GetHash() const { return hash; }
+    // MeasureDetectorTime needs nCircles <= GetCircles()
+    inline Int_t GetCircles() const { return nCircles; }
+
+    // The event of entry k, per-channel stage done. The event is reused by
+    // the next call
+    EventLYSO& GetEntry(Long64_t k);
+
+  private:
+    std::unique_ptr<TFile> cacheFile;
+    TTree *lyso_channels = nullptr;
+    Long64_t nEntries = 0;
+    ULong64_t hash = 0;
+    Int_t nCircles = 0;
+
+    std::unique_ptr<ChannelCacheBuffer> buffer;
+    std::unique_ptr<TimeCalibrationLYSO> calibration;
+    std::unique_ptr<EventLYSO> event;
+};
+
+
+#endif // CHANNELCACHELYSO_HH
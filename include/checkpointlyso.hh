@@ -0,0 +1,58 @@
+#ifndef CHECKPOINTLYSO_HH
+#define CHECKPOINTLYSO_HH
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <Rtypes.h>
+
+
+// Progress of the entries [first, last) of a bar file into an output file.
+// The output is written in chunks, closed files with ShardInfo committed
+// one at a time in <output>.progress together with the identity of the input
+// and the hash of the run configuration. A record that does not match the
+// run is discarded
+class CheckpointLYSO
+{
+  public:
+    // inputUUID: identity of the bar file in the shard info of the chunks
+    CheckpointLYSO(const std::string& outputFilename, const std::string& barFilename, const std::string& inputUUID,
+                   Long64_t first, Long64_t last, ULong64_t runHash);
+    ~CheckpointLYSO() = default;
+
+    // First entry to analyze: first, the entry after the last committed
+    // chunk, or last if the output is already complete
+    inline Long64_t GetResumeEntry() const { return committed; }
+    inline Bool_t IsComplete() const { return isComplete; }
+
+    // Chunk starting at entry start
+    std::string GetChunkFilename(Long64_t start) const;
+    // The chunk [start, end) is closed: commit it
+    Bool_t Commit(Long64_t start, Long64_t end);
+    // Merge the chunks into the output
+    Bool_t Finalize();
+
+    // Delete the progress record of an output
+    static void Remove(const std::string& outputFilename);
+
+  private:
+    static std::string RecordFilename(const std::string& outputFilename);
+    Bool_t Load();
+    Bool_t Save() const;
+
+    std::string outputFilename;
+    std::string barFilename;
+    std::string inputUUID;
+    Long64_t inputSize = 0;
+    Long_t inputMtime = 0;
+    Long64_t first, last;
+    ULong64_t runHash;
+
+    Long64_t committed;
+    std::vector<Long64_t> chunkStarts;
+    Bool_t isComplete = false;
+};
+
+
+#endif // CHECKPOINTLYSO_HH
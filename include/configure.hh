@@ -27,10 +27,13 @@ class ConfigAnalyzer
     Int_t upInt;
     Int_t nCircles_Time;
     Int_t nCircles_Position;
+    std::string outputTier = "full"; // summary, triggered or full
 
     // Load configuration from a file
     void LoadConfig(const char* filename);
     void PrintDebug() const;
+    // Hash of every parameter, for the progress records
+    ULong64_t GetHash() const;
 
   private:
     ConfigAnalyzer() = default; // Private constructor for singleton pattern
@@ -38,5 +41,8 @@ class ConfigAnalyzer
     ConfigAnalyzer& operator=(const ConfigAnalyzer&) = delete;
 };
 
+// FNV-1a hash of a text, e.g. of the printed parameters
+ULong64_t HashFNV1a(const std::string& text);
+
 
 #endif // CONFIGANALYZER_HH
@@ -0,0 +1,140 @@
+#ifndef ESTIMATORSMPPC_HH
+#define ESTIMATORSMPPC_HH
+
+#include <iostream>
+
+#include <TMath.h>
+
+#include "globals.hh"
+#include "configure.hh"
+
+constexpr Int_t MAX_FRACTIONS = 8; /**< @brief Maximum number of constant fractions of the fused kernel */
+
+
+// Parameters of the per-channel estimation (see analyze.mac)
+struct ParametersMPPC
+{
+    Float_t trgLevel = -0.050;
+    Int_t lowBase = 100;
+    Int_t upBase = 300;
+    Int_t lowInt = 400;
+    Int_t upInt = 1000;
+
+    // Constant fractions, Float_t as in WaveformMPPC::MeasureTimeCF
+    Int_t nFractions = 3;
+    Float_t fractions[MAX_FRACTIONS] = {0.15, 0.25, 0.50};
+
+    // Current ConfigAnalyzer values with the 15%, 25%, 50% fractions
+    static ParametersMPPC FromConfig();
+    // Hash of every parameter: per-channel results are the same for the same hash
+    ULong64_t GetHash() const;
+};
+
+
+// Per-channel estimators, same definitions as WaveformMPPC
+struct EstimatorsMPPC
+{
+    Double_t baseline;
+    Double_t sigmaNoise;
+    Double_t charge;
+    Double_t amplitude;
+    Bool_t   trigger;
+    Int_t    trgCell; // -1 if not triggered
+    Double_t timeCF[MAX_FRACTIONS]; // -1 if not triggered
+};
+
+
+// The 15%, 25%, 50% fractions of the analysis, known at compile time
+struct DefaultFractionsMPPC
+{
+    static constexpr Int_t N = 3;
+    static constexpr Float_t values[N] = {0.15, 0.25, 0.50};
+    static constexpr Int_t percents[N] = {15, 25, 50};
+};
+
+
+// Windows and fractions of the kernels. DynamicShapeMPPC reads them from the
+// parameters; FixedShapeMPPC has them as constants, so that the loops have a
+// fixed length the compiler can unroll and vectorize. Same operations in the
+// same order: results are identical
+struct DynamicShapeMPPC
+{
+    const ParametersMPPC& par;
+
+    inline Int_t LowBase() const { return par.lowBase; }
+    inline Int_t UpBase() const { return par.upBase; }
+    inline Int_t LowInt() const { return par.lowInt; }
+    inline Int_t UpInt() const { return par.upInt; }
+    inline Int_t NFractions() const { return par.nFractions; }
+    inline Float_t Fraction(Int_t j) const { return par.fractions[j]; }
+};
+
+template<Int_t LOW_BASE, Int_t UP_BASE, Int_t LOW_INT, Int_t UP_INT, typename Fractions>
+struct FixedShapeMPPC
+{
+    static_assert(Fractions::N <= MAX_FRACTIONS, "Too many fractions");
+
+    static constexpr Int_t LowBase() { return LOW_BASE; }
+    static constexpr Int_t UpBase() { return UP_BASE; }
+    static constexpr Int_t LowInt() { return LOW_INT; }
+    static constexpr Int_t UpInt() { return UP_INT; }
+    static constexpr Int_t NFractions() { return Fractions::N; }
+    static constexpr Float_t Fraction(Int_t j) { return Fractions::values[j]; }
+
+    // True if par has these windows and fractions
+    static Bool_t Matches(const ParametersMPPC& par)
+    {
+        if(par.lowBase != LOW_BASE || par.upBase != UP_BASE || par.lowInt != LOW_INT || par.upInt != UP_INT || par.nFractions != Fractions::N)
+            return false;
+        for(Int_t j = 0; j < Fractions::N; j++)
+        {
+            if(par.fractions[j] != Fractions::values[j])
+                return false;
+        }
+        return true;
+    }
+};
+
+// Windows of analyze.mac
+using DefaultShapeMPPC = FixedShapeMPPC<100, 300, 400, 1000, DefaultFractionsMPPC>;
+
+
+// Fused kernel: baseline, noise, charge, amplitude, trigger and every CF time
+// of one waveform in three sweeps (baseline window, integration window,
+// crossing search) without temporaries. Results are identical to the
+// WaveformMPPC methods. T is Float_t for the event buffer, Double_t for WaveDRS.
+// With the windows and fractions of DefaultShapeMPPC the fixed-shape kernels run
+template<typename T>
+void MeasureEstimatorsMPPC(const T* times, const T* samples, const ParametersMPPC& par, EstimatorsMPPC& est);
+
+// Baseline and noise from the sums of x and x^2 over [lowBase, upBase]
+template<typename Shape>
+inline void SetBaselineMPPC(Double_t sum, Double_t sumSquares, const Shape& shape, EstimatorsMPPC& est)
+{
+    Double_t n = shape.UpBase() - shape.LowBase() + 1;
+    est.baseline = sum / n;
+    est.sigmaNoise = n < 2 ? 0. : TMath::Sqrt(1. / (n - 1.) * (sumSquares - sum*sum / n));
+}
+
+// The two halves of the fused kernel: sweeps 1-2 (baseline, noise, charge,
+// amplitude, trigger) and sweep 3 (CF times, needs the results of sweeps 1-2)
+template<typename T>
+void MeasureWindowsMPPC(const T* times, const T* samples, const ParametersMPPC& par, EstimatorsMPPC& est);
+template<typename T>
+void MeasureTimesCFMPPC(const T* times, const T* samples, const ParametersMPPC& par, EstimatorsMPPC& est);
+// Sweep 2 alone (charge, amplitude, trigger) on est.baseline of a previous
+// sweep 1 with the same baseline window
+template<typename T>
+void MeasureIntegralMPPC(const T* times, const T* samples, const ParametersMPPC& par, EstimatorsMPPC& est);
+
+// Same, with the shape already chosen (DynamicShapeMPPC or DefaultShapeMPPC).
+// par gives the trigger level
+template<typename T, typename Shape>
+void MeasureWindowsMPPC(const T* times, const T* samples, const ParametersMPPC& par, const Shape& shape, EstimatorsMPPC& est);
+template<typename T, typename Shape>
+void MeasureTimesCFMPPC(const T* times, const T* samples, const ParametersMPPC& par, const Shape& shape, EstimatorsMPPC& est);
+template<typename T, typename Shape>
+void MeasureIntegralMPPC(const T* times, const T* samples, const ParametersMPPC& par, const Shape& shape, EstimatorsMPPC& est);
+
+
+#endif // ESTIMATORSMPPC_HH
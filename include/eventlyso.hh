@@ -12,18 +12,43 @@
 #include <ROOT/RVec.hxx>
 
 #include "globals.hh"
+#include "alignedallocator.hh"
+#include "geometrylyso.hh"
 #include "waveformmppc.hh"
+#include "estimatorsmppc.hh"
 #include "configure.hh"
 
 
 class EventLYSO
 {
 public:
+    // Empty, for Load: one event per thread, reloaded for every entry
     EventLYSO() = default;
-    EventLYSO(Int_t evtID, std::vector<ROOT::RVecD> times_F, std::vector<ROOT::RVecD> times_B, std::vector<ROOT::RVecD> volts_F, std::vector<ROOT::RVecD> volts_B);
+    // Samples are packed in the event buffer, times are views on the input: they must outlive the analysis of the event
+    EventLYSO(Int_t evtID, const std::vector<ROOT::RVecF>& times_F, const std::vector<ROOT::RVecF>& times_B, const std::vector<ROOT::RVecF>& volts_F, const std::vector<ROOT::RVecF>& volts_B);
+    // Times by grid, times[face*CHANNELS + ch] (e.g. from TimeCalibrationLYSO): the grids must outlive the analysis of the event
+    EventLYSO(Int_t evtID, const Float_t* const times[], const std::vector<ROOT::RVecF>& volts_F, const std::vector<ROOT::RVecF>& volts_B);
+    // Samples already packed as [face][channel][sample] (see PackSamples), taken over by the event
+    EventLYSO(Int_t evtID, const Float_t* const times[], AlignedVector<Float_t>&& samples);
+    // Not copyable: the estimator vectors are views on the member arrays
+    EventLYSO(const EventLYSO&) = delete;
+    EventLYSO& operator=(const EventLYSO&) = delete;
     ~EventLYSO() = default;
 
-    void CalculateEstimatorsForEveryMPPC();
+    // Same as the constructors on an existing event: the samples are packed
+    // in (or swapped with) its buffer, nothing is allocated after the first
+    void Load(Int_t evtID, const Float_t* const times[], const std::vector<ROOT::RVecF>& volts_F, const std::vector<ROOT::RVecF>& volts_B);
+    void Load(Int_t evtID, const Float_t* const times[], AlignedVector<Float_t>&& samples);
+
+    void CalculateEstimatorsForEveryMPPC(const ParametersMPPC& par = ParametersMPPC::FromConfig());
+    // Same, after a CalculateEstimatorsForEveryMPPC with the same windows
+    // (lowBase/upBase, lowInt/upInt): baselines, charges and amplitudes are
+    // kept, triggers and CF times are measured again for par.trgLevel
+    void UpdateTriggersForEveryMPPC(const ParametersMPPC& par);
+    // Same, after a CalculateEstimatorsForEveryMPPC with the same baseline
+    // window (lowBase/upBase): baselines are kept, charges, amplitudes,
+    // triggers and CF times are measured again for par
+    void UpdateIntegralsForEveryMPPC(const ParametersMPPC& par);
 
     // Global analysis (left public for debugging)
     inline Int_t FindFrontChOfMaxCharge() const { return ROOT::VecOps::ArgMax(fCharges_F); };
@@ -31,32 +56,75 @@ public:
     inline Int_t FindFrontChOfMaxAmplitude() const { return ROOT::VecOps::ArgMax(fAmplitudes_F); };
     inline Int_t FindBackChOfMaxAmplitude() const { return ROOT::VecOps::ArgMax(fAmplitudes_B); };
 
+    // Charge-weighted moments of the cluster around the channel of max amplitude
+    ClusterMoments GetClusterMoments(const char* face = "F", Int_t nCircles = 0);
     Double_t GetCentroidX(const char* face = "F", Int_t nCircles = 0);
     Double_t GetCentroidY(const char* face = "F", Int_t nCircles = 0);
     std::pair<Double_t, Double_t> GetCentroidStdDev(const char* face = "F", Int_t nCircles = 0);
 
     // Global Estimation Methods
         // Energy
-    void MeasureDetectorCharge(ROOT::RVecI channelsFront = ROOT::VecOps::Range(CHANNELS), ROOT::RVecI channelsBack = ROOT::VecOps::Range(CHANNELS));
+    void MeasureDetectorCharge();
+    void MeasureDetectorCharge(const ROOT::RVecI& channelsFront, const ROOT::RVecI& channelsBack);
         // Time
-    void MeasureDetectorTime(Int_t nCircles = ConfigAnalyzer::GetInstance()->nCircles_Time);
+    // par: integration window and trigger level of the summed waveforms, the
+    // ones of the per-channel stage (e.g. of a scan point)
+    void MeasureDetectorTime(Int_t nCircles = ConfigAnalyzer::GetInstance()->nCircles_Time, const ParametersMPPC& par = ParametersMPPC::FromConfig());
         // Position
     void MeasureDetectorPosition(Int_t nCircles = ConfigAnalyzer::GetInstance()->nCircles_Position);
 
+    // Estimators access, face = 0 (Front) or 1 (Back)
+    inline Int_t GetEventID() const { return EventAZ; }
+    inline Double_t GetCharge(Int_t face) const { return face == 0 ? Charge_F : Charge_B; }
+    inline Double_t GetChargeTot() const { return Charge_Tot; }
+    inline const Double_t* GetTime15(Int_t face) const { return face == 0 ? Time15_F : Time15_B; }
+    inline const Double_t* GetTime25(Int_t face) const { return face == 0 ? Time25_F : Time25_B; }
+    inline const Double_t* GetTime50(Int_t face) const { return face == 0 ? Time50_F : Time50_B; }
+    inline const Double_t* GetCentroid(Int_t face) const { return face == 0 ? Centroid_F : Centroid_B; }
+        // Per-channel columns, CHANNELS long
+    inline const Double_t* GetCharges(Int_t face) const { return face == 0 ? Charges_F : Charges_B; }
+    inline const Double_t* GetAmplitudes(Int_t face) const { return face == 0 ? Amplitudes_F : Amplitudes_B; }
+    inline const Double_t* GetTimeCFs15(Int_t face) const { return face == 0 ? TimeCFs15_F : TimeCFs15_B; }
+    inline const Double_t* GetTimeCFs25(Int_t face) const { return face == 0 ? TimeCFs25_F : TimeCFs25_B; }
+    inline const Double_t* GetTimeCFs50(Int_t face) const { return face == 0 ? TimeCFs50_F : TimeCFs50_B; }
+    inline const Bool_t* GetTriggers(Int_t face) const { return face == 0 ? Triggers_F : Triggers_B; }
+
+    // Event buffer access, face = 0 (Front) or 1 (Back)
+    static void PackSamples(const std::vector<ROOT::RVecF>& volts_F, const std::vector<ROOT::RVecF>& volts_B, Float_t* samples);
+    // Give the event buffer back for reuse, the event can't be analyzed anymore
+    inline AlignedVector<Float_t> ReleaseSamples() { return std::move(fSamples); }
+    inline const Float_t* GetSamples(Int_t face, Int_t ch) const { return fSamples.data() + (face*CHANNELS + ch)*SAMPLINGS; }
+    inline const Float_t* GetTimes(Int_t face, Int_t ch) const { return fTimes[face*CHANNELS + ch]; }
+    inline const Double_t* GetBaselines(Int_t face) const { return fBaselines[face]; }
+
 private:
+    // Loads the per-channel stage from the cache
+    friend class ChannelCacheLYSO;
+
     // Auxiliary methods
-    void FillEstimatorsVectors();
+    void AddToSum(Double_t* sumTimes, Double_t* sumSamples, const Float_t*& baseTimes, Int_t face, Int_t ch) const;
 
     ROOT::RVecI FindFirstNeighbors(Int_t meanCh, Int_t nCircles = 0);
-    WaveformMPPC SumWaveforms(ROOT::RVecI channelsFront = ROOT::VecOps::Range(CHANNELS), ROOT::RVecI channelsBack = ROOT::VecOps::Range(CHANNELS));
-    WaveformMPPC SumWaveforms(const char* face, ROOT::RVecI channels = ROOT::VecOps::Range(CHANNELS));
+    // Views on the ArenaLYSO of the thread: valid until its scope ends
+    WaveformMPPC SumWaveforms(const ROOT::RVecI& channelsFront, const ROOT::RVecI& channelsBack);
+    WaveformMPPC SumWaveforms(const char* face, const ROOT::RVecI& channels);
 
 
     // Members
     Int_t EventAZ;
-        // Single estimators
-    std::vector<WaveformMPPC> Front;
-    std::vector<WaveformMPPC> Back;
+        // Single estimators, one column per estimator indexed by channel
+    Double_t Charges_F[CHANNELS];
+    Double_t Charges_B[CHANNELS];
+    Double_t Amplitudes_F[CHANNELS];
+    Double_t Amplitudes_B[CHANNELS];
+    Double_t TimeCFs15_F[CHANNELS];
+    Double_t TimeCFs15_B[CHANNELS];
+    Double_t TimeCFs25_F[CHANNELS];
+    Double_t TimeCFs25_B[CHANNELS];
+    Double_t TimeCFs50_F[CHANNELS];
+    Double_t TimeCFs50_B[CHANNELS];
+    Bool_t   Triggers_F[CHANNELS];
+    Bool_t   Triggers_B[CHANNELS];
         // Global estimators
     Double_t Charge_F;
     Double_t Charge_B;
@@ -71,20 +139,25 @@ private:
     Double_t Centroid_B[4]; // x, y, sigmax, sigmay
 
     
-    // Vectors of Front and Back estimators
+    // Event buffer: samples laid out as [face][channel][sample]
+    AlignedVector<Float_t> fSamples; //!
+    const Float_t*         fTimes[FACES*CHANNELS] = {}; //!
+    Double_t               fBaselines[FACES][CHANNELS]; //!
+
+    // Views of Front and Back estimators (no copies)
         // Useful for global estimation
-    ROOT::RVecD        fCharges_F; //!
-    ROOT::RVecD        fAmplitudes_F; //!
-    ROOT::RVecD        fTimeCFs15_F; //!
-    ROOT::RVecD        fTimeCFs25_F; //!
-    ROOT::RVecD        fTimeCFs50_F; //!
-    ROOT::RVec<Bool_t> fTrigger_F; //!
-    ROOT::RVecD        fCharges_B; //!
-    ROOT::RVecD        fAmplitudes_B; //!
-    ROOT::RVecD        fTimeCFs15_B; //!
-    ROOT::RVecD        fTimeCFs25_B; //!
-    ROOT::RVecD        fTimeCFs50_B; //!
-    ROOT::RVec<Bool_t> fTrigger_B; //!
+    ROOT::RVecD        fCharges_F = ROOT::RVecD(Charges_F, CHANNELS); //!
+    ROOT::RVecD        fAmplitudes_F = ROOT::RVecD(Amplitudes_F, CHANNELS); //!
+    ROOT::RVecD        fTimeCFs15_F = ROOT::RVecD(TimeCFs15_F, CHANNELS); //!
+    ROOT::RVecD        fTimeCFs25_F = ROOT::RVecD(TimeCFs25_F, CHANNELS); //!
+    ROOT::RVecD        fTimeCFs50_F = ROOT::RVecD(TimeCFs50_F, CHANNELS); //!
+    ROOT::RVec<Bool_t> fTrigger_F = ROOT::RVec<Bool_t>(Triggers_F, CHANNELS); //!
+    ROOT::RVecD        fCharges_B = ROOT::RVecD(Charges_B, CHANNELS); //!
+    ROOT::RVecD        fAmplitudes_B = ROOT::RVecD(Amplitudes_B, CHANNELS); //!
+    ROOT::RVecD        fTimeCFs15_B = ROOT::RVecD(TimeCFs15_B, CHANNELS); //!
+    ROOT::RVecD        fTimeCFs25_B = ROOT::RVecD(TimeCFs25_B, CHANNELS); //!
+    ROOT::RVecD        fTimeCFs50_B = ROOT::RVecD(TimeCFs50_B, CHANNELS); //!
+    ROOT::RVec<Bool_t> fTrigger_B = ROOT::RVec<Bool_t>(Triggers_B, CHANNELS); //!
 };
 
 
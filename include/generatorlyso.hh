@@ -0,0 +1,110 @@
+#ifndef GENERATORLYSO_HH
+#define GENERATORLYSO_HH
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <ROOT/RVec.hxx>
+
+#include "globals.hh"
+#include "timecalibrationlyso.hh"
+
+class TFile;
+
+
+// Parameters of the synthetic events. Times in ns, voltages in V, lengths in mm
+struct GeneratorParameters
+{
+    Long64_t nEvents = 1000;
+    UInt_t seed = 1;
+    Int_t compression = -1;         // ROOT compression settings, -1 = ROOT default
+
+    // DRS time base
+    Double_t samplingPeriod = 0.2;  // 5 GS/s
+    Double_t cellJitter = 0.;       // relative rms of the cell widths, per channel
+    Bool_t stopCells = false;       // random stop cell per face, StopCell_F/B branches
+
+    // Pulse: (1 - exp(-t/riseTime))*exp(-t/decayTime), negative
+    Double_t riseTime = 1.;
+    Double_t decayTime = 40.;
+    Double_t pulseTime = 100.;      // start of the pulse
+    Double_t timeJitter = 0.5;      // rms of the start, per event
+
+    // Light: peak amplitude gaussian in the distance from the hit
+    Double_t amplitude = 0.5;       // at the hit, front face
+    Double_t amplitudeSpread = 0.1; // relative rms, per event
+    Double_t lightSpread = 8.;      // sigma on a face
+    Double_t backRatio = 1.;        // back/front amplitude
+
+    // Hit: uniform on the detX/detY grid, or gaussian around (hitX, hitY)
+    Bool_t uniformHit = true;
+    Double_t hitX = 0.;
+    Double_t hitY = 0.;
+    Double_t hitSigma = 0.;
+
+    // Noise on a flat baseline
+    Double_t baseline = 0.;
+    Double_t noise = 0.002;
+
+    // Pile-up: extra pulses per event (poisson mean), uniform hit, time and
+    // amplitude in (0, amplitude)
+    Double_t pileUp = 0.;
+
+    // Set one parameter by option name (e.g. "events", "pile-up", "hit"),
+    // false if unknown or not valid
+    Bool_t Set(const std::string& name, const std::string& value);
+    // "name = value" lines
+    std::string ToString() const;
+};
+
+
+
+// One event of the bar file schema
+struct GeneratedEventLYSO
+{
+    Int_t evt = 0;
+    std::vector<ROOT::RVecF> volts_F, volts_B;
+    std::vector<Int_t> stopCell_F, stopCell_B;
+
+    GeneratedEventLYSO();
+};
+
+
+
+// Synthetic bar files (lyso_wfs and lyso_wfs_times, with the BarID schema).
+// Event k only depends on the seed and k: the files don't depend on the threads
+class GeneratorLYSO
+{
+  public:
+    explicit GeneratorLYSO(const GeneratorParameters& par = GeneratorParameters());
+    ~GeneratorLYSO() = default;
+
+    inline const GeneratorParameters& GetParameters() const { return fPar; }
+    // Stop cell 0 grids, the lyso_wfs_times entry
+    inline const std::vector<ROOT::RVecF>& GetTimes_F() const { return fTimes_F; }
+    inline const std::vector<ROOT::RVecF>& GetTimes_B() const { return fTimes_B; }
+    inline const std::shared_ptr<TimeCalibrationLYSO>& GetCalibration() const { return fCalibration; }
+
+    // Event k into event. Thread-safe
+    void Generate(Long64_t k, GeneratedEventLYSO& event) const;
+
+    // Events [0, nEvents) into filename. With nThreads > 1 every thread writes
+    // a block into a part file, then the parts are concatenated in order
+    Bool_t Write(const std::string& filename, Int_t nThreads = 1) const;
+
+  private:
+    // Events [first, last), with lyso_wfs_times if withTimes
+    Bool_t WriteBlock(const std::string& filename, Long64_t first, Long64_t last, Bool_t withTimes) const;
+    // lyso_wfs_times, the stop cell 0 grids
+    Bool_t WriteTimes(TFile* file) const;
+
+    GeneratorParameters fPar;
+    std::vector<ROOT::RVecF> fTimes_F, fTimes_B;
+    std::shared_ptr<TimeCalibrationLYSO> fCalibration;
+    Double_t fPeak; // peak of the pulse shape, for the normalization
+};
+
+
+#endif // GENERATORLYSO_HH
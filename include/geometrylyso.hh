@@ -0,0 +1,91 @@
+#ifndef GEOMETRYLYSO_HH
+#define GEOMETRYLYSO_HH
+
+#include <iostream>
+#include <vector>
+#include <limits>
+
+#include <TMath.h>
+#include <ROOT/RVec.hxx>
+
+#include "globals.hh"
+
+constexpr Int_t MAX_CIRCLES = 12; /**< @brief From this number of circles on, the neighbors are the whole detector */
+
+
+// Neighbor tables of the MPPC grid, derived from detX/detY at compile time
+class GeometryLYSO
+{
+  public:
+    // Singleton, thread-safe initialization
+    static const GeometryLYSO* GetInstance()
+    {
+        static const GeometryLYSO instance;
+        return &instance;
+    }
+
+    // Channels within nCircles rings around ch (ch itself included), ascending.
+    // O(1), no allocation: the pointer is into the table
+    inline const Int_t* GetNeighbors(Int_t ch, Int_t nCircles, Int_t& size) const
+    {
+        nCircles = TMath::Min(nCircles, MAX_CIRCLES);
+        const Int_t* offsets = fOffsets[nCircles];
+        size = offsets[ch+1] - offsets[ch];
+        return fChannels + offsets[ch];
+    }
+
+    // Same as above, as a non-owning RVec view
+    inline ROOT::RVecI GetNeighbors(Int_t ch, Int_t nCircles) const
+    {
+        Int_t size;
+        const Int_t* channels = GetNeighbors(ch, nCircles, size);
+        return ROOT::RVecI(const_cast<Int_t*>(channels), size);
+    }
+
+  private:
+    GeometryLYSO();
+    GeometryLYSO(const GeometryLYSO&) = delete;
+    GeometryLYSO& operator=(const GeometryLYSO&) = delete;
+
+    // Neighbor lists of every (nCircles, channel), back to back
+    const Int_t* fChannels;
+    const Int_t (*fOffsets)[CHANNELS + 1];
+};
+
+
+// Weighted moments of a cluster of channels. Second moments are taken about
+// the origin (x0, y0), a channel of the cluster, to avoid cancellations
+struct ClusterMoments
+{
+    Double_t sumW = 0;   // Σw
+    Double_t sumWX = 0;  // Σwx
+    Double_t sumWY = 0;  // Σwy
+    Double_t sumWX2 = 0; // Σw(x - x0)²
+    Double_t sumWY2 = 0; // Σw(y - y0)²
+    Double_t x0 = 0;
+    Double_t y0 = 0;
+
+    inline Double_t GetX() const { return sumWX/sumW; }
+    inline Double_t GetY() const { return sumWY/sumW; }
+    inline Double_t GetSigmaX() const { return GetSigma(sumWX2/sumW, GetX() - x0); }
+    inline Double_t GetSigmaY() const { return GetSigma(sumWY2/sumW, GetY() - y0); }
+
+    // sqrt(<(x - x0)²> - (<x> - x0)²). A negative residue within rounding of
+    // 0 is 0; a larger negative variance (weights of mixed sign, e.g. charges
+    // of noise-only channels) stays NaN, as with the two-pass formula
+    static inline Double_t GetSigma(Double_t meanSquare, Double_t d)
+    {
+        Double_t variance = meanSquare - d*d;
+        if(variance < 0 && -variance <= 16*std::numeric_limits<Double_t>::epsilon()*(TMath::Abs(meanSquare) + d*d))
+            return 0.;
+        return TMath::Sqrt(variance);
+    }
+};
+
+
+// One pass over the selected channels, weights indexed by channel (e.g. the
+// charges, or log-weights for a log-weighted centroid). originCh sets (x0, y0)
+ClusterMoments MeasureClusterMoments(const Double_t* weights, const Int_t* channels, Int_t nChannels, Int_t originCh);
+
+
+#endif // GEOMETRYLYSO_HH
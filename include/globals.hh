@@ -5,13 +5,45 @@
 #include <utility>
 #include <ROOT/RVec.hxx>
 
+constexpr Int_t FACES = 2; /**< @brief Faces of the detector: 0 = Front, 1 = Back */
 constexpr Int_t CHANNELS = 115; /**< @brief Number of channels of the detectors */
 constexpr Int_t SAMPLINGS = 1024; /**< @brief Number of samplings for one waveform */
 constexpr Float_t ZERO_TIME_BIN = 450.0; /**< @brief Delay of all waveforms in the [0, 1023] bins window */
 
-// Coordinates of MPPCs (Si layers)
-extern const ROOT::RVecD detX; //!
-extern const ROOT::RVecD detY; //!
+// Coordinates of MPPCs (Si layers), constants for the compile-time geometry
+constexpr Double_t detX[CHANNELS] =
+{
+    -7.6, -0.25, 7.1, 
+    -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 
+    -29.65, -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 29.15, 
+    -37, -29.65, -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 29.15, 36.5,
+    -37, -29.65, -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 29.15, 36.5,
+    -37, -29.65, -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 29.15, 36.5,
+    -37, -29.65, -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 29.15, 36.5,
+    -37, -29.65, -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 29.15, 36.5,
+    -37, -29.65, -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 29.15, 36.5,
+    -37, -29.65, -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 29.15, 36.5,
+    -29.65, -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 29.15, 
+    -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 
+    -7.6, -0.25, 7.1
+};
+
+constexpr Double_t detY[CHANNELS] =
+{
+    41.1, 41.1, 41.1, 
+    34.25, 34.25, 34.25, 34.25, 34.25, 34.25, 34.25, 
+    27.4, 27.4, 27.4, 27.4, 27.4, 27.4, 27.4, 27.4, 27.4, 
+    20.55, 20.55, 20.55, 20.55, 20.55, 20.55, 20.55, 20.55, 20.55, 20.55, 20.55, 
+    13.7, 13.7, 13.7, 13.7, 13.7, 13.7, 13.7, 13.7, 13.7, 13.7, 13.7,
+    6.85, 6.85, 6.85, 6.85, 6.85, 6.85, 6.85, 6.85, 6.85, 6.85, 6.85,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    -6.85, -6.85, -6.85, -6.85, -6.85, -6.85, -6.85, -6.85, -6.85, -6.85, -6.85,
+    -13.7, -13.7, -13.7, -13.7, -13.7, -13.7, -13.7, -13.7, -13.7, -13.7, -13.7,
+    -20.55, -20.55, -20.55, -20.55, -20.55, -20.55, -20.55, -20.55, -20.55, -20.55, -20.55,
+    -27.4, -27.4, -27.4, -27.4, -27.4, -27.4, -27.4, -27.4, -27.4,
+    -34.25, -34.25, -34.25, -34.25, -34.25, -34.25, -34.25,
+    -41.1, -41.1, -41.1
+};
 
 constexpr Double_t xSideDet = 7.35; // mm 
 constexpr Double_t ySideDet = 6.85; // mm 
@@ -0,0 +1,76 @@
+#ifndef HWCOUNTERSLYSO_HH
+#define HWCOUNTERSLYSO_HH
+
+#include <iostream>
+#include <string>
+#include <atomic>
+
+#include <Rtypes.h>
+
+
+// Counters read by HwCountersLYSO
+enum class HwEventLYSO : Int_t
+{
+    Cycles,
+    Instructions,
+    CacheMisses,
+    BranchMisses,
+    PageFaults,
+    N
+};
+
+const char* GetHwEventName(HwEventLYSO event);
+
+
+
+// perf_event_open counters of the calling thread, user space only, read
+// together as one group. Events the kernel or the container refuses are
+// left out (read as 0); without any of them the counters are not valid
+class HwCountersLYSO
+{
+  public:
+    static constexpr Int_t N = (Int_t)HwEventLYSO::N;
+
+    HwCountersLYSO();
+    ~HwCountersLYSO();
+    HwCountersLYSO(const HwCountersLYSO&) = delete;
+    HwCountersLYSO& operator=(const HwCountersLYSO&) = delete;
+
+    inline Bool_t IsValid() const { return fLeader >= 0; }
+    inline Bool_t Has(HwEventLYSO event) const { return fIndex[(Int_t)event] >= 0; }
+    // Events opened, or why not
+    inline const std::string& GetStatus() const { return fStatus; }
+
+    // Current values since the opening, one read(2) for the group
+    void Read(ULong64_t values[N]) const;
+
+  private:
+    Int_t fLeader = -1;
+    Int_t fFds[N];
+    Int_t fIndex[N]; // position in the group read, -1 if not opened
+    Int_t fOpened = 0;
+    std::string fStatus;
+};
+
+
+
+// Sums of the counters over the calls of a region (stage or kernel), with the
+// items (e.g. channels) of each call. Single writer, like StageCounters
+struct HwTotals
+{
+    std::atomic<ULong64_t> calls{0};
+    std::atomic<ULong64_t> items{0};
+    std::atomic<ULong64_t> counts[HwCountersLYSO::N] = {};
+
+    inline void Add(const ULong64_t start[], const ULong64_t end[], ULong64_t nItems)
+    {
+        auto add = [](std::atomic<ULong64_t>& x, ULong64_t v) { x.store(x.load(std::memory_order_relaxed) + v, std::memory_order_relaxed); };
+        add(calls, 1);
+        add(items, nItems);
+        for(Int_t e = 0; e < HwCountersLYSO::N; e++)
+            add(counts[e], end[e] - start[e]);
+    }
+};
+
+
+#endif // HWCOUNTERSLYSO_HH
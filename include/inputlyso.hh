@@ -0,0 +1,72 @@
+#ifndef INPUTLYSO_HH
+#define INPUTLYSO_HH
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+
+#include <TFile.h>
+#include <TTree.h>
+#include <ROOT/RVec.hxx>
+
+#include "globals.hh"
+#include "timecalibrationlyso.hh"
+
+
+class InputLYSO
+{
+  public:
+    // One instance per thread: TTree reading is not thread-safe. The time
+    // calibration can be shared between the instances of the same file
+    InputLYSO(const char* barFilename, std::shared_ptr<TimeCalibrationLYSO> calibration = nullptr);
+    ~InputLYSO();
+
+    inline Bool_t IsValid() const { return lyso_wfs != nullptr && lyso_wfs_times != nullptr; }
+    inline Long64_t GetEntries() const { return nEntries; }
+    // Identity of the bar file, kept by its copies
+    inline std::string GetUUID() const { return barFile->GetUUID().AsString(); }
+
+    // Load entry k of lyso_wfs into the branch buffers and pick its time grids
+    void GetEntry(Long64_t k);
+
+    // TTreeCache on every branch for the entries [first, last), optionally
+    // with prefetching of the next cluster (only if this input reads them all)
+    void SetCache(Long64_t first, Long64_t last, Long64_t cacheSize, Bool_t isPrefetching);
+    // Clusters of lyso_wfs in [first, last), as [start, end) ranges
+    std::vector<std::pair<Long64_t, Long64_t>> GetClusters(Long64_t first, Long64_t last) const;
+
+    // Data of the current entry, read in place from the branch buffers
+    inline Int_t GetEvent() const { return fEvent; }
+    inline const std::vector<ROOT::RVecF>& GetTime_F() const { return *fTime_F; }
+    inline const std::vector<ROOT::RVecF>& GetTime_B() const { return *fTime_B; }
+    inline const std::vector<ROOT::RVecF>& GetFront() const { return *fFront; }
+    inline const std::vector<ROOT::RVecF>& GetBack() const { return *fBack; }
+
+    // Time grids of the current entry, [face*CHANNELS + ch]
+    inline const Float_t* const* GetTimeGrids() const { return fTimeGrids; }
+    inline Bool_t HasStopCells() const { return fStopCell_F != nullptr; }
+    inline const std::shared_ptr<TimeCalibrationLYSO>& GetCalibration() const { return fCalibration; }
+
+  private:
+    std::unique_ptr<TFile> barFile;
+    TTree *lyso_wfs_times = nullptr;
+    TTree *lyso_wfs = nullptr;
+    Long64_t nEntries = 0;
+
+    // Branch buffers
+    Int_t fEvent = 0;
+    std::vector<ROOT::RVecF> *fTime_F = nullptr;
+    std::vector<ROOT::RVecF> *fTime_B = nullptr;
+    std::vector<ROOT::RVecF> *fFront = nullptr;
+    std::vector<ROOT::RVecF> *fBack = nullptr;
+    // Optional, DRS stop cell of every channel. Without them stop cell 0
+    std::vector<Int_t> *fStopCell_F = nullptr;
+    std::vector<Int_t> *fStopCell_B = nullptr;
+
+    std::shared_ptr<TimeCalibrationLYSO> fCalibration;
+    const Float_t* fTimeGrids[FACES*CHANNELS] = {};
+};
+
+
+#endif // INPUTLYSO_HH
@@ -0,0 +1,116 @@
+#ifndef LOOPANALYZER_HH
+#define LOOPANALYZER_HH
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include "inputlyso.hh"
+#include "readaheadlyso.hh"
+#include "eventlyso.hh"
+#include "outputlyso.hh"
+#include "shardlyso.hh"
+#include "scanlyso.hh"
+#include "metricslyso.hh"
+
+
+class LoopAnalyzer
+{
+  public:
+    LoopAnalyzer(const char* barFilename, const char* outputFilename);
+    ~LoopAnalyzer() = default;
+
+    // Options
+    inline void SetThreads(Int_t n) { nThreads = n > 0 ? n : 1; }
+    inline void SetOrdered(Bool_t ordered) { isOrdered = ordered; }
+    inline void SetOutputFormat(OutputFormat format) { outputFormat = format; }
+    inline void SetOutputTier(OutputTier tier) { outputTier = tier; }
+    // Events decoded ahead by nReaders I/O threads per analysis thread, 0 = read in the analysis thread
+    inline void SetReadAhead(Int_t queueSize, Int_t nReaders = 1) { readAhead = queueSize > 0 ? queueSize : 0; readers = nReaders > 0 ? nReaders : 1; }
+
+    // Analyze only the entries [first, last) (last < 0: to the end), or
+    // shard i of n equal blocks. The range is stored in the output (ShardInfo)
+    inline void SetEntryRange(Long64_t first, Long64_t last) { firstEntry = first; lastEntry = last; }
+    inline void SetShard(Int_t i, Int_t n) { shard = i; nShards = n; }
+    // Output written in chunks of n entries with a progress record: a killed
+    // run restarted with the same options goes on from the last chunk. 0 = off
+    inline void SetCheckpoint(Long64_t n) { checkpointEntries = n > 0 ? n : 0; }
+    // Also write the per-channel stage into a cache (ChannelCacheLYSO), with the
+    // waveforms within nCircles of the max (< 0: nCircles_Time of the config)
+    inline void SetChannelCacheOutput(const std::string& filename, Int_t nCircles = -1) { cacheOutputFilename = filename; cacheCircles = nCircles; }
+    // Global stage only, on the per-channel stage of a cache: the bar file is not read
+    inline void SetChannelCacheInput(const std::string& filename) { cacheInputFilename = filename; }
+    // Every configuration of the scan on each decoded event, one output per
+    // configuration (ScanLYSO::GetFilename) instead of outputFilename
+    inline void SetScan(const ScanLYSO& s) { scan = s; }
+    // Per-thread timing of the stages of the event loop, shared by the runs of a batch
+    inline void SetMetrics(std::shared_ptr<MetricsLYSO> m) { metrics = std::move(m); }
+    // Progress and summary on stdout
+    inline void SetVerbose(Bool_t verbose) { isVerbose = verbose; }
+
+    // Run the event loop, returns false on I/O errors
+    Bool_t Run();
+    inline Long64_t GetEntries() const { return nEntries; }
+
+  private:
+    // Event loop strategies
+    // Resolve the entry range on totalEntries, true if it is not all of them
+    Bool_t SetEntries(Long64_t totalEntries);
+    Bool_t RunSequential();
+    Bool_t RunParallelOrdered();
+    Bool_t RunParallelUnordered();
+    Bool_t RunGlobalStage();
+    Bool_t RunScan();
+
+    // Entries [first, last) into filename (and cacheFilename if not empty), checkpointed if enabled
+    Bool_t AnalyzeBlock(const std::string& filename, Long64_t first, Long64_t last, const std::string& cacheFilename = "");
+    // Analyze up to maxEntries entries of input (< 0: all), filling output and
+    // the cache if any. Returns how many
+    Long64_t AnalyzeEntries(ReadAheadLYSO& input, OutputLYSO& output, OutputLYSO* cache = nullptr, Long64_t maxEntries = -1);
+    // Entries [first, last) with every configuration of the scan into filenames
+    Bool_t AnalyzeScanBlock(const std::vector<std::string>& filenames, Long64_t first, Long64_t last);
+    ULong64_t GetRunHash() const;
+    inline MetricsThreadLYSO* GetMetricsThread(const std::string& role) const { return metrics ? metrics->GetThread(role) : nullptr; }
+    void PrintProgress();
+    void PrintReadAheadStats() const;
+
+    std::string barFilename;
+    std::string outputFilename;
+    Int_t nThreads = 1;
+    Bool_t isOrdered = false;
+    OutputFormat outputFormat = OutputFormat::TTree;
+    OutputTier outputTier = OutputTier::Full;
+    Int_t readAhead = 8;
+    Int_t readers = 1;
+    Bool_t isVerbose = true;
+    Long64_t checkpointEntries = 0;
+    std::string cacheOutputFilename;
+    Int_t cacheCircles = -1;
+    std::string cacheInputFilename;
+    ScanLYSO scan;
+    std::shared_ptr<MetricsLYSO> metrics;
+
+    Long64_t firstEntry = 0;
+    Long64_t lastEntry = -1;
+    Int_t shard = 0;
+    Int_t nShards = 1;
+
+    Long64_t nEntries = 0; // to analyze, from firstEntry
+    std::string inputUUID; // of the bar file or channel cache, in the shard info
+    std::shared_ptr<TimeCalibrationLYSO> calibration;
+    std::atomic<Long64_t> nProcessed{0};
+    std::chrono::steady_clock::time_point startTime;
+    std::mutex printMutex;
+    ReadAheadStats readAheadStats; // of every thread, guarded by printMutex
+};
+
+
+#endif // LOOPANALYZER_HH
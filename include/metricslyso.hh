@@ -0,0 +1,254 @@
+#ifndef METRICSLYSO_HH
+#define METRICSLYSO_HH
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <algorithm>
+
+#include <Rtypes.h>
+
+#include "hwcounterslyso.hh"
+
+
+// Stages of the event loop
+enum class StageLYSO : Int_t
+{
+    GetEntry,   // TTree::GetEntry of lyso_wfs
+    Pack,       // waveforms into the SoA buffer of the event
+    Construct,  // EventLYSO::Load
+    Channels,   // CalculateEstimatorsForEveryMPPC
+    Charge,     // MeasureDetectorCharge
+    Time,       // MeasureDetectorTime
+    Position,   // MeasureDetectorPosition
+    Fill,       // output (and cache) Fill
+    Write,      // closing and merging the outputs
+    N
+};
+
+const char* GetStageName(StageLYSO stage);
+
+
+
+// Kernels profiled with the hardware counters, inside the stages
+enum class KernelLYSO : Int_t
+{
+    Windows,      // MeasureWindowsMPPC: baselines, charges, amplitudes
+    TimesCF,      // MeasureTimesCFMPPC of every channel
+    SumWaveforms, // summed waveforms of MeasureDetectorTime
+    N
+};
+
+const char* GetKernelName(KernelLYSO kernel);
+
+
+
+// Count, sum, max and latency histogram of one stage. Bins are log-linear,
+// 4 per octave of ns (bin upper edges 1, 2, 3, 4, 5, 6, 7, 8, 10, 12, ...).
+// Written by one thread, read by the exporter at any time
+struct StageCounters
+{
+    static constexpr Int_t BINS = 160;
+
+    std::atomic<ULong64_t> count{0};
+    std::atomic<ULong64_t> sum{0}; // ns
+    std::atomic<ULong64_t> max{0}; // ns
+    std::atomic<ULong64_t> bins[BINS] = {};
+
+    static Int_t GetBin(ULong64_t ns);
+    // Exclusive upper edge of bin, ns
+    static ULong64_t GetBinEdge(Int_t bin);
+
+    // Single writer: plain loads and stores, no locked instructions
+    inline void Add(ULong64_t ns)
+    {
+        auto add = [](std::atomic<ULong64_t>& x, ULong64_t v) { x.store(x.load(std::memory_order_relaxed) + v, std::memory_order_relaxed); };
+        add(count, 1);
+        add(sum, ns);
+        add(bins[GetBin(ns)], 1);
+        if(ns > max.load(std::memory_order_relaxed))
+            max.store(ns, std::memory_order_relaxed);
+    }
+};
+
+
+
+// Counters of one thread of the run (e.g. "analysis-0", "reader-1")
+class MetricsThreadLYSO
+{
+  public:
+    explicit MetricsThreadLYSO(const std::string& name) : fName(name) {}
+
+    inline const std::string& GetName() const { return fName; }
+    inline void Add(StageLYSO stage, ULong64_t ns) { fStages[(Int_t)stage].Add(ns); }
+    inline void AddEvent() { fEvents.store(fEvents.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+    inline const StageCounters& GetStage(StageLYSO stage) const { return fStages[(Int_t)stage]; }
+    inline ULong64_t GetEvents() const { return fEvents.load(std::memory_order_relaxed); }
+
+    // Hardware counters of the calling thread, false if none could be opened.
+    // status: HwCountersLYSO::GetStatus
+    Bool_t EnableHw(std::string& status);
+    // Close them, by the same thread when it exits: the totals stay
+    inline void DisableHw() { fHw.reset(); }
+    inline const HwCountersLYSO* GetHw() const { return fHw.get(); }
+    // The totals come from hardware counters (also once they are closed)
+    inline Bool_t HasHw() const { return isHw; }
+    inline HwTotals& GetHwStage(StageLYSO stage) { return fHwStages[(Int_t)stage]; }
+    inline HwTotals& GetHwKernel(KernelLYSO kernel) { return fHwKernels[(Int_t)kernel]; }
+
+  private:
+    std::string fName;
+    std::atomic<ULong64_t> fEvents{0};
+    StageCounters fStages[(Int_t)StageLYSO::N];
+
+    std::unique_ptr<HwCountersLYSO> fHw;
+    Bool_t isHw = false;
+    HwTotals fHwStages[(Int_t)StageLYSO::N];
+    HwTotals fHwKernels[(Int_t)KernelLYSO::N];
+};
+
+
+
+// Times consecutive stages: every Lap records the time (and the hardware
+// counters, if enabled) since the previous one. Without a thread (metrics
+// off) it does nothing, not even reading the clock
+class StageTimerLYSO
+{
+  public:
+    explicit StageTimerLYSO(MetricsThreadLYSO* thread) : fThread(thread) { Restart(); }
+
+    inline void Restart()
+    {
+        if(!fThread)
+            return;
+        if(fThread->GetHw())
+            fThread->GetHw()->Read(fHwStart);
+        fStart = std::chrono::steady_clock::now();
+    }
+
+    inline void Lap(StageLYSO stage)
+    {
+        if(!fThread)
+            return;
+        auto now = std::chrono::steady_clock::now();
+        fThread->Add(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(now - fStart).count());
+        if(fThread->GetHw())
+        {
+            // The read itself is left out of the next stage
+            ULong64_t hw[HwCountersLYSO::N];
+            fThread->GetHw()->Read(hw);
+            fThread->GetHwStage(stage).Add(fHwStart, hw, 1);
+            std::copy(hw, hw + HwCountersLYSO::N, fHwStart);
+            now = std::chrono::steady_clock::now();
+        }
+        fStart = now;
+    }
+
+  private:
+    MetricsThreadLYSO* fThread;
+    std::chrono::steady_clock::time_point fStart;
+    ULong64_t fHwStart[HwCountersLYSO::N];
+};
+
+
+
+// Hardware counters of a kernel over its scope, in the thread counters last
+// given by MetricsLYSO::GetThread. Only a thread-local load when they are off
+class KernelScopeLYSO
+{
+  public:
+    KernelScopeLYSO(KernelLYSO kernel, ULong64_t items)
+        : fThread(current && current->GetHw() ? current : nullptr), fKernel(kernel), fItems(items)
+    {
+        if(fThread)
+            fThread->GetHw()->Read(fStart);
+    }
+
+    ~KernelScopeLYSO()
+    {
+        if(!fThread)
+            return;
+        ULong64_t end[HwCountersLYSO::N];
+        fThread->GetHw()->Read(end);
+        fThread->GetHwKernel(fKernel).Add(fStart, end, fItems);
+    }
+
+    static inline void SetThread(MetricsThreadLYSO* thread) { current = thread; }
+
+  private:
+    static thread_local MetricsThreadLYSO* current;
+
+    MetricsThreadLYSO* fThread;
+    KernelLYSO fKernel;
+    ULong64_t fItems;
+    ULong64_t fStart[HwCountersLYSO::N];
+};
+
+
+
+// Per-thread stage metrics of a run (or a batch of runs), exported to
+// <prefix>.json and <prefix>.prom (Prometheus text format) every period and
+// at Stop. The files are written aside and renamed: never partial. With
+// hardware counters (perf_event_open) every stage and kernel is also profiled
+class MetricsLYSO
+{
+  public:
+    // period <= 0: export only at Stop. Empty prefix: no export
+    MetricsLYSO(const std::string& prefix, Double_t period = 10., Bool_t hw = false);
+    ~MetricsLYSO();
+
+    // Counters of the calling thread in the given role, created on first
+    // use and named "<role>-<n>", and current ones of the kernel scopes of
+    // the thread. A thread started later (e.g. by the next job of a batch)
+    // gets new counters, and the hardware ones are closed at thread exit.
+    // Thread-safe
+    MetricsThreadLYSO* GetThread(const std::string& role);
+
+    // Start the clock and the periodic export
+    void Start();
+    // Stop the periodic export, last export. Returns false on write errors
+    Bool_t Stop();
+    Bool_t Export();
+
+    ULong64_t GetEvents();
+    Double_t GetElapsed() const;
+    // Events/s and per-stage latencies of all the threads, and the hardware
+    // counters per event and per channel
+    void Print();
+
+  private:
+    void PrintHw();
+    Bool_t WriteJSON(const std::string& filename);
+    Bool_t WritePrometheus(const std::string& filename);
+
+    std::string fPrefix;
+    Double_t fPeriod;
+    Bool_t isHwEnabled;
+    std::string fHwStatus; // of the first thread
+    Int_t nHwThreads = 0;
+    Bool_t fHwHas[HwCountersLYSO::N]; // events opened by every thread
+    std::chrono::steady_clock::time_point fStart;
+
+    std::mutex fMutex; // fThreads, fIndex
+    // Shared with the threads, that close their hardware counters at exit
+    std::vector<std::shared_ptr<MetricsThreadLYSO>> fThreads;
+    // By serial number of the thread: the std::thread::id of a joined thread
+    // is given to the next ones
+    std::map<std::pair<ULong64_t, std::string>, MetricsThreadLYSO*> fIndex;
+    std::map<std::string, Int_t> fRoles;
+
+    std::mutex fExportMutex;
+    std::condition_variable fStopCV;
+    Bool_t isStopping = false;
+    std::thread fExporter;
+};
+
+
+#endif // METRICSLYSO_HH
@@ -0,0 +1,61 @@
+#ifndef OUTPUTLYSO_HH
+#define OUTPUTLYSO_HH
+
+#include <iostream>
+#include <string>
+#include <memory>
+
+#include "eventlyso.hh"
+
+
+// Backends of lyso_est
+enum class OutputFormat
+{
+    TTree,  // one EventEstimators branch streaming EventLYSO (default)
+    RNTuple // one native field per estimator
+};
+
+Bool_t ParseOutputFormat(const std::string& name, OutputFormat& format);
+const char* GetOutputFormatName(OutputFormat format);
+
+// Content of lyso_est, from the config file
+enum class OutputTier
+{
+    Summary,   // EventAZ, Charge_*, Time*, Centroid_*
+    Triggered, // + estimators of the triggered channels only, Trg*_F/B
+    Full       // + estimators of every channel. TTree: the EventEstimators branch
+};
+
+Bool_t ParseOutputTier(const std::string& name, OutputTier& tier);
+const char* GetOutputTierName(OutputTier tier);
+
+
+
+// Writer of lyso_est entries, one per thread
+class OutputLYSO
+{
+  public:
+    virtual ~OutputLYSO() = default;
+
+    virtual void Fill(const EventLYSO& event) = 0;
+};
+
+
+
+// Output file, handing out the writers
+class OutputFileLYSO
+{
+  public:
+    // If isShared, several threads write their own OutputLYSO into the file
+    // at the same time. Returns nullptr on errors
+    static std::unique_ptr<OutputFileLYSO> Create(OutputFormat format, OutputTier tier, const std::string& filename, Bool_t isShared = false);
+    virtual ~OutputFileLYSO() = default;
+
+    // Thread-safe for shared files. A file that is not shared takes one writer
+    virtual std::unique_ptr<OutputLYSO> CreateWriter() = 0;
+    // Once every writer is gone. Returns false on I/O errors
+    virtual Bool_t Close() = 0;
+};
+
+
+#endif // OUTPUTLYSO_HH
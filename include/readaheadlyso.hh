@@ -0,0 +1,94 @@
+#ifndef READAHEADLYSO_HH
+#define READAHEADLYSO_HH
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "globals.hh"
+#include "alignedallocator.hh"
+#include "inputlyso.hh"
+#include "timecalibrationlyso.hh"
+#include "metricslyso.hh"
+
+
+// One lyso_wfs entry, ready for EventLYSO
+struct DecodedEventLYSO
+{
+    Long64_t entry;
+    Int_t event;
+    const Float_t* times[FACES*CHANNELS];
+    AlignedVector<Float_t> samples = AlignedVector<Float_t>(FACES*CHANNELS*SAMPLINGS); // [face][channel][sample]
+};
+
+
+
+// Seconds spent by the stages of the pipeline
+struct ReadAheadStats
+{
+    Double_t read = 0;          // GetEntry and packing
+    Double_t readerStall = 0;   // readers waiting for room in the queue: analysis is the bottleneck
+    Double_t consumerStall = 0; // analysis waiting for an event: I/O is the bottleneck
+
+    ReadAheadStats& operator+=(const ReadAheadStats& other);
+};
+
+
+
+// Entries [first, last) of a bar file, decoded by I/O threads into a
+// bounded queue and handed out in entry order. Every reader has its own
+// InputLYSO and reads whole clusters, the readers take turns over the
+// clusters. With queueSize 0 there are no readers: Pop reads in place.
+// With metrics, GetEntry and Pack are timed in the thread that reads
+class ReadAheadLYSO
+{
+  public:
+    ReadAheadLYSO(const char* barFilename, std::shared_ptr<TimeCalibrationLYSO> calibration, Long64_t first, Long64_t last,
+                  Int_t queueSize = 8, Int_t nReaders = 1, MetricsLYSO* metrics = nullptr);
+    ~ReadAheadLYSO();
+
+    inline Bool_t IsValid() const { return isValid; }
+
+    // Next event, false at the end
+    Bool_t Pop(std::unique_ptr<DecodedEventLYSO>& event);
+    inline Bool_t HasNext() const { return fNext < fLast; }
+    // Give a popped event back, its buffer is reused
+    void Recycle(std::unique_ptr<DecodedEventLYSO> event);
+
+    ReadAheadStats GetStats();
+
+  private:
+    void ReadLoop(Int_t reader);
+    void Read(InputLYSO& input, Long64_t k, DecodedEventLYSO& event, MetricsThreadLYSO* stats);
+    std::unique_ptr<DecodedEventLYSO> TakeFree();
+
+    Long64_t fFirst, fLast;
+    Int_t fQueueSize;
+    Bool_t isValid = true;
+
+    std::vector<std::unique_ptr<InputLYSO>> fInputs; // one per reader
+    std::vector<std::pair<Long64_t, Long64_t>> fClusters;
+
+    // Decoded events, entry k in slot (k - fFirst) % fQueueSize: readers only
+    // fill entries below fNext + fQueueSize. No allocation per event
+    std::vector<std::unique_ptr<DecodedEventLYSO>> fReady;
+    std::vector<std::unique_ptr<DecodedEventLYSO>> fFree;
+    Long64_t fNext;
+    Bool_t isStopping = false;
+
+    std::mutex fMutex;
+    std::condition_variable fRoomCV;
+    std::condition_variable fDataCV;
+    std::vector<std::thread> fReaders;
+
+    ReadAheadStats fStats;
+    MetricsLYSO* fMetrics;
+    MetricsThreadLYSO* fSyncStats = nullptr;
+};
+
+
+#endif // READAHEADLYSO_HH
@@ -0,0 +1,101 @@
+#ifndef SCANLYSO_HH
+#define SCANLYSO_HH
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "globals.hh"
+#include "estimatorsmppc.hh"
+#include "eventlyso.hh"
+#include "metricslyso.hh"
+
+
+// Parameters of one configuration of the analysis, the analyze.mac ones
+// without the singleton
+struct ParametersLYSO
+{
+    ParametersMPPC mppc;
+    Int_t nCircles_Time = 1;
+    Int_t nCircles_Position = 1;
+
+    // Current ConfigAnalyzer values
+    static ParametersLYSO FromConfig();
+    // Set one analyze.mac parameter, false if unknown
+    Bool_t Set(const std::string& name, const std::string& value);
+    // analyze.mac lines, "name = value"
+    std::string ToString() const;
+};
+
+
+
+// Scan of many configurations on the same events: every event is decoded
+// once and analyzed with every configuration (point) of the scan
+class ScanLYSO
+{
+  public:
+    ScanLYSO() = default;
+    explicit ScanLYSO(std::vector<ParametersLYSO> points);
+
+    // Scan file: analyze.mac lines with lists ("lowInt = 380, 400, 420") or
+    // ranges ("trgLevel = -0.06:-0.03:0.01", stop included) of values. The
+    // points are the grid of all the combinations, the other parameters are
+    // the ones of base. Lines "---" start another grid: a list of
+    // configurations is a series of one-point grids. Returns false on errors
+    static Bool_t Parse(const char* filename, const ParametersLYSO& base, std::vector<ParametersLYSO>& points);
+
+    inline Bool_t IsEmpty() const { return fPoints.empty(); }
+    inline Int_t GetSize() const { return fPoints.size(); }
+    inline const ParametersLYSO& GetPoint(Int_t k) const { return fPoints[k]; }
+    // Output of point k: "<stem>_scan<k>.root", k zero-padded
+    std::string GetFilename(const std::string& outputFilename, Int_t k) const;
+    // Config of point k stored in its output as lyso_config (TNamed)
+    Bool_t WriteConfig(const std::string& filename, Int_t k) const;
+    void Print() const;
+
+    // Estimators of event for every point, fill(k, event) after each one.
+    // Points with the same baseline window share the baselines of the
+    // per-channel stage, and also its charges and amplitudes if only trgLevel
+    // changes. The stages of all the points are timed by timer, if any
+    template<class F>
+    void ForEachPoint(EventLYSO& event, F fill, StageTimerLYSO* timer = nullptr) const
+    {
+        StageTimerLYSO off(nullptr);
+        StageTimerLYSO& t = timer ? *timer : off;
+        const ParametersLYSO* previous = nullptr;
+        for(Int_t k : fOrder)
+        {
+            const ParametersLYSO& p = fPoints[k];
+            if(!previous || !IsSameBaseline(previous->mppc, p.mppc))
+                event.CalculateEstimatorsForEveryMPPC(p.mppc);
+            else if(!IsSameWindows(previous->mppc, p.mppc))
+                event.UpdateIntegralsForEveryMPPC(p.mppc);
+            else if(previous->mppc.trgLevel != p.mppc.trgLevel)
+                event.UpdateTriggersForEveryMPPC(p.mppc);
+            t.Lap(StageLYSO::Channels);
+
+            event.MeasureDetectorCharge();
+            t.Lap(StageLYSO::Charge);
+            event.MeasureDetectorTime(p.nCircles_Time, p.mppc);
+            t.Lap(StageLYSO::Time);
+            event.MeasureDetectorPosition(p.nCircles_Position);
+            t.Lap(StageLYSO::Position);
+            fill(k, event);
+            t.Lap(StageLYSO::Fill);
+
+            previous = &p;
+        }
+    }
+
+  private:
+    static Bool_t IsSameBaseline(const ParametersMPPC& a, const ParametersMPPC& b);
+    static Bool_t IsSameWindows(const ParametersMPPC& a, const ParametersMPPC& b);
+
+    std::vector<ParametersLYSO> fPoints;
+    // Evaluation order: points with the same baseline window, and within them
+    // the same integration window, next to each other
+    std::vector<Int_t> fOrder;
+};
+
+
+#endif // SCANLYSO_HH
@@ -0,0 +1,45 @@
+#ifndef SHARDLYSO_HH
+#define SHARDLYSO_HH
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <Rtypes.h>
+
+
+// Entries [first, last) of a bar file of total entries, analyzed into one output
+struct ShardInfo
+{
+    Long64_t first = 0;
+    Long64_t last = 0;
+    Long64_t total = 0;
+    // UUID of the analyzed file (bar file or channel cache): same for every
+    // copy of the file, different for another run of the DAQ
+    std::string input;
+};
+
+// Output name with the shard tag before ".root"
+std::string ShardFilename(const std::string& outputFilename, const std::string& tag);
+// "shard<i>of<n>", i zero-padded so that the names sort in entry order
+std::string ShardTag(Int_t shard, Int_t nShards);
+// "entries<first>to<last>"
+std::string EntryRangeTag(Long64_t first, Long64_t last);
+
+// Stored next to lyso_est as lyso_shard_first/last/total/input
+Bool_t WriteShardInfo(const std::string& filename, const ShardInfo& info);
+Bool_t ReadShardInfo(const std::string& filename, ShardInfo& info);
+
+// Trees of the files (lyso_est by default) concatenated in the given order, by fast merging
+Bool_t ConcatenateOutputs(const std::string& outputFilename, const std::vector<std::string>& filenames,
+                          const std::vector<std::string>& treeNames = {"lyso_est"});
+
+// lyso_est of the shards concatenated in entry order, by fast merging (baskets
+// and pages are copied, no EventLYSO is re-streamed). Returns false on shards
+// without info, gaps, overlaps or shards of different inputs, unless isForced:
+// then they are merged anyway (shards without info in the given order),
+// without shard info in the output
+Bool_t MergeShards(const std::string& outputFilename, std::vector<std::string> shardFilenames, Bool_t isForced = false);
+
+
+#endif // SHARDLYSO_HH
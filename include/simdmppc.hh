@@ -0,0 +1,41 @@
+#ifndef SIMDMPPC_HH
+#define SIMDMPPC_HH
+
+#include <iostream>
+
+#include "globals.hh"
+#include "estimatorsmppc.hh"
+
+
+// Instruction sets of the vectorized kernels, selected at runtime
+enum class SimdLevel { Scalar, SSE42, AVX2, AVX512 };
+
+// Best level supported by the CPU, or ANALYZER_SIMD=scalar|sse4.2|avx2|avx512 if set
+SimdLevel GetSimdLevel();
+// Force a level (benchmarks, debugging), capped to what the CPU supports
+void SetSimdLevel(SimdLevel level);
+const char* GetSimdLevelName(SimdLevel level);
+// "scalar", "sse4.2", "avx2" or "avx512", false if unknown
+Bool_t ParseSimdLevel(const char* name, SimdLevel& level);
+
+
+// Sweeps 1-2 of the fused kernel (baseline, noise, charge, amplitude, trigger)
+// for n waveforms at once. Vector lanes run over channels, each lane following
+// the sample order of the scalar kernel: results are bit-identical to it
+void MeasureWindowsMPPC(const Float_t* const times[], const Float_t* const samples[], Int_t n, const ParametersMPPC& par, EstimatorsMPPC est[]);
+
+
+// First bin from binStart towards binEnd (both included, reverse search if
+// binStart > binEnd) where sample >= value (isGreaterOrLesser = true) or
+// sample <= value (false), -1 if not found. Float samples are compared in
+// blocks with a movemask reduction, Double_t samples one by one
+Int_t FindCrossingMPPC(const Float_t* samples, Double_t value, Bool_t isGreaterOrLesser, Int_t binStart, Int_t binEnd);
+Int_t FindCrossingMPPC(const Double_t* samples, Double_t value, Bool_t isGreaterOrLesser, Int_t binStart, Int_t binEnd);
+
+// Forward search of n values in one sweep over [binStart, binEnd]:
+// bins[j] = first bin where sample <= values[j], -1 if not found
+void FindCrossingsMPPC(const Float_t* samples, const Double_t values[], Int_t n, Int_t binStart, Int_t binEnd, Int_t bins[]);
+void FindCrossingsMPPC(const Double_t* samples, const Double_t values[], Int_t n, Int_t binStart, Int_t binEnd, Int_t bins[]);
+
+
+#endif // SIMDMPPC_HH
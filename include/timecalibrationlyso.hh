@@ -0,0 +1,65 @@
+#ifndef TIMECALIBRATIONLYSO_HH
+#define TIMECALIBRATIONLYSO_HH
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+
+#include <TMath.h>
+#include <ROOT/RVec.hxx>
+
+#include "globals.hh"
+
+
+// DRS4 time grids of every channel, one per stop cell. The grid of stop
+// cell s is the stop cell 0 grid with its cell widths rotated by s. Grids are
+// built on first use and shared by all threads; channels with the same
+// calibration share the same grids
+class TimeCalibrationLYSO
+{
+  public:
+    // Stop cell 0 grids, e.g. lyso_wfs_times entry 0
+    TimeCalibrationLYSO(const std::vector<ROOT::RVecF>& times_F, const std::vector<ROOT::RVecF>& times_B);
+    ~TimeCalibrationLYSO() = default;
+
+    // Time grid of (face, ch) for stopCell in [0, SAMPLINGS). Thread-safe
+    inline const Float_t* GetTimes(Int_t face, Int_t ch, Int_t stopCell = 0)
+    {
+        Int_t cls = fClass[face*CHANNELS + ch];
+        const Float_t* grid = fGrids[cls*SAMPLINGS + stopCell].load(std::memory_order_acquire);
+        return grid ? grid : BuildGrid(cls, stopCell);
+    }
+
+    // Stop cell of a grid of (face, ch) given by GetTimes, -1 if it is not one
+    inline Int_t FindStopCell(Int_t face, Int_t ch, const Float_t* times) const
+    {
+        Int_t cls = fClass[face*CHANNELS + ch];
+        for(Int_t cell = 0; cell < SAMPLINGS; cell++)
+        {
+            if(fGrids[cls*SAMPLINGS + cell].load(std::memory_order_acquire) == times)
+                return cell;
+        }
+        return -1;
+    }
+
+    // Number of different calibrations and of grids built so far
+    inline Int_t GetNClasses() const { return fWidths.size(); }
+    Int_t GetNGrids();
+
+  private:
+    const Float_t* BuildGrid(Int_t cls, Int_t stopCell);
+
+    std::vector<Int_t> fClass; // calibration of every face*CHANNELS + ch
+    std::vector<std::vector<Double_t>> fWidths; // cell widths of every calibration
+    std::vector<Double_t> fStart; // time of the first sample of every calibration
+
+    // [calibration][stop cell], owned by fPool
+    std::unique_ptr<std::atomic<const Float_t*>[]> fGrids;
+    std::vector<std::unique_ptr<Float_t[]>> fPool;
+    std::mutex fPoolMutex;
+};
+
+
+#endif // TIMECALIBRATIONLYSO_HH
@@ -13,22 +13,33 @@
 #include "wavedrs.hh"
 #include "configure.hh"
 
+struct ParametersMPPC;
+
 class WaveformMPPC
 {
   public:
     WaveformMPPC() = default;
-    WaveformMPPC(Int_t chid, ROOT::RVecD times, ROOT::RVecD volts);
+    // Non-owning: times and volts must outlive the waveform (e.g. the ROOT branch buffers of the current entry)
+    WaveformMPPC(Int_t chid, const ROOT::RVecF& times, const ROOT::RVecF& volts);
+    WaveformMPPC(Int_t chid, const Float_t* times, const Float_t* volts, Int_t size = SAMPLINGS);
     WaveformMPPC(WaveDRS wave);
+    // Non-owning, on double buffers (e.g. a summed waveform in the ArenaLYSO of the thread)
+    WaveformMPPC(const Double_t* times, const Double_t* samples, Int_t size, Double_t baseline);
     ~WaveformMPPC() = default;
     
     // Methods for estimation
     void MeasureCharge(Int_t binStart = ConfigAnalyzer::GetInstance()->lowInt, Int_t binStop = ConfigAnalyzer::GetInstance()->upInt);
     void MeasureAmplitude(Int_t binStart = ConfigAnalyzer::GetInstance()->lowInt, Int_t binStop = ConfigAnalyzer::GetInstance()->upInt);
     void MeasureTimeCF(Float_t frac, Int_t leFrac);
+    // Every fraction of Fractions (e.g. DefaultFractionsMPPC) with one
+    // amplitude and trigger cell search, with the integration window and
+    // trigger level of par instead of the ConfigAnalyzer ones
+    template<typename Fractions>
+    void MeasureTimesCF(const ParametersMPPC& par);
     void MeasureBaseline(Int_t binStart = ConfigAnalyzer::GetInstance()->lowBase, Int_t binStop = ConfigAnalyzer::GetInstance()->upBase);
 
     // Getters
-    inline WaveDRS GetWave() const { return fWave; }
+    WaveDRS GetWave() const;
 
     inline Double_t GetCharge() const { return Charge; }
     inline Double_t GetAmplitude() const { return Amplitude; }
@@ -36,13 +47,42 @@ class WaveformMPPC
     inline Double_t GetTimeCF25() const { return TimeCF25; }
     inline Double_t GetTimeCF50() const { return TimeCF50; }
     inline Bool_t GetTrigger() const { return Trigger; }
+    inline Double_t GetBaseline() const { return Baseline; }
 
   private:
     // Auxiliary methods
     Int_t CrossingPoint(Double_t value, Bool_t isGreaterOrLesser, Int_t binStart, Int_t binEnd);
+    void SetAmplitude(Int_t binStart, Int_t binStop, Float_t trgLevel);
+    // CF time of a triggered waveform, amplitude and trigger cell given
+    Double_t TimeCF(Float_t frac, Int_t leFrac, Int_t trgCell, Float_t trgLevel);
+    inline Double_t& TimeCFOf(Int_t leFrac)
+    {
+        switch(leFrac)
+        {
+            case 15:
+            default:
+                return TimeCF15;
+            case 25:
+                return TimeCF25;
+            case 50:
+                return TimeCF50;
+        }
+    }
+
+    // Call f(times, samples) on the float views or on the owned fWave
+    template<typename F>
+    decltype(auto) VisitSamples(F&& f) const
+    {
+        if(fSamplesView)
+            return f(fTimesView, fSamplesView);
+        return f(fWave.times.data(), fWave.samples.data());
+    }
     
 
     WaveDRS fWave; //!
+    const Float_t* fTimesView = nullptr; //!
+    const Float_t* fSamplesView = nullptr; //!
+    Int_t fSize = 0; //!
     Int_t Ch; // Channel of MPPC
 
     // Estimators
@@ -59,4 +99,4 @@ class WaveformMPPC
 };
 
 
-#endif // WAVEFORMMPPC_HH
\ No newline at end of file
+#endif // WAVEFORMMPPC_HH
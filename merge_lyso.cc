@@ -0,0 +1,47 @@
+//****************************************************************************//
+//                                                                            //
+//          Merge of the lyso_est shards written by 'analyzer_lyso'           //
+//                                                                            //
+//****************************************************************************//
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "shardlyso.hh"
+
+using namespace std;
+
+
+
+
+int main(int argc, char** argv)
+{
+    // --force: merge shards without info, gaps, overlaps and shards of different inputs too
+    vector<string> args(argv + 1, argv + argc);
+    Bool_t isForced = false;
+    auto force = find(args.begin(), args.end(), "--force");
+    if(force != args.end())
+    {
+        isForced = true;
+        args.erase(force);
+    }
+
+    if(args.size() < 2)
+    {
+        cerr << "Usage: " << argv[0] << " [--force] <outputFilename> <shardFilename> [<shardFilename> ...]" << endl;
+        return 1;
+    }
+
+    const string outputFilename = args[0];
+    vector<string> shardFilenames(args.begin() + 1, args.end());
+
+    if(!MergeShards(outputFilename, shardFilenames, isForced))
+        return 1;
+
+    cout << "MergeLYSO>> " << shardFilenames.size() << " shards merged into " << outputFilename << endl;
+
+    // Finally
+    return 0;
+}
@@ -0,0 +1,172 @@
+#include "analysislyso.hh"
+
+#include <algorithm>
+
+using namespace std;
+using namespace ROOT;
+using namespace ROOT::RDF;
+
+
+AnalysisLYSO::AnalysisLYSO(shared_ptr<TimeCalibrationLYSO> calibration, const ParametersMPPC& par, Int_t nCircles_Time, Int_t nCircles_Position)
+    : fCalibration(move(calibration)), fPar(par), fCircles_Time(nCircles_Time), fCircles_Position(nCircles_Position)
+{
+}
+
+
+
+AnalysisLYSO::EventPtr AnalysisLYSO::operator()(Int_t event, const vector<RVecF>& front, const vector<RVecF>& back) const
+{
+    return Analyze(event, front, back);
+}
+
+
+
+AnalysisLYSO::EventPtr AnalysisLYSO::Analyze(Int_t event, const vector<RVecF>& front, const vector<RVecF>& back,
+                                             const vector<Int_t>* stopCells_F, const vector<Int_t>* stopCells_B) const
+{
+    auto eventlyso = CreateEvent(event, front, back, stopCells_F, stopCells_B);
+
+    eventlyso->CalculateEstimatorsForEveryMPPC(fPar);
+    eventlyso->MeasureDetectorCharge();
+    eventlyso->MeasureDetectorTime(fCircles_Time, fPar);
+    eventlyso->MeasureDetectorPosition(fCircles_Position);
+
+    return eventlyso;
+}
+
+
+
+AnalysisLYSO::EventPtr AnalysisLYSO::AnalyzeChannels(Int_t event, const vector<RVecF>& front, const vector<RVecF>& back,
+                                                     const vector<Int_t>* stopCells_F, const vector<Int_t>* stopCells_B) const
+{
+    auto eventlyso = CreateEvent(event, front, back, stopCells_F, stopCells_B);
+    eventlyso->CalculateEstimatorsForEveryMPPC(fPar);
+
+    return eventlyso;
+}
+
+
+
+shared_ptr<EventLYSO> AnalysisLYSO::CreateEvent(Int_t event, const vector<RVecF>& front, const vector<RVecF>& back,
+                                                const vector<Int_t>* stopCells_F, const vector<Int_t>* stopCells_B) const
+{
+    const vector<Int_t>* stopCells[FACES] = {stopCells_F, stopCells_B};
+    const Float_t* times[FACES*CHANNELS];
+
+    for(Int_t face = 0; face < FACES; face++)
+    {
+        for(Int_t ch = 0; ch < CHANNELS; ch++)
+        {
+            Int_t cell = 0;
+            if(stopCells[face] && ch < (Int_t)stopCells[face]->size())
+                cell = (*stopCells[face])[ch];
+            if(cell < 0 || cell >= SAMPLINGS)
+                cell = 0;
+            times[face*CHANNELS + ch] = fCalibration->GetTimes(face, ch, cell);
+        }
+    }
+
+    return make_shared<EventLYSO>(event, times, front, back);
+}
+
+
+
+RNode AnalysisLYSO::DefineColumns(RNode df, OutputTier tier, vector<string>& columns, const string& eventColumn)
+{
+    const char* const faceSuffix[FACES] = {"_F", "_B"};
+    const ColumnNames_t input = {eventColumn};
+
+    auto define = [&df, &columns, &input](const string& name, auto f)
+    {
+        df = df.Define(name, f, input);
+        columns.push_back(name);
+    };
+
+    define("EventAZ", [](const EventPtr& e) { return e->GetEventID(); });
+    define("Charge_Tot", [](const EventPtr& e) { return e->GetChargeTot(); });
+
+    using Getter = const Double_t* (EventLYSO::*)(Int_t) const;
+    const struct { const char* name; Getter get; Int_t n; } globals[] =
+    {
+        {"Time15", &EventLYSO::GetTime15, 5},
+        {"Time25", &EventLYSO::GetTime25, 5},
+        {"Time50", &EventLYSO::GetTime50, 5},
+        {"Centroid", &EventLYSO::GetCentroid, 4}
+    };
+    const struct { const char* name; Getter get; } channels[] =
+    {
+        {"Charges", &EventLYSO::GetCharges},
+        {"Amplitudes", &EventLYSO::GetAmplitudes},
+        {"TimeCFs15", &EventLYSO::GetTimeCFs15},
+        {"TimeCFs25", &EventLYSO::GetTimeCFs25},
+        {"TimeCFs50", &EventLYSO::GetTimeCFs50}
+    };
+
+    for(Int_t face = 0; face < FACES; face++)
+    {
+        string suffix = faceSuffix[face];
+
+        define("Charge" + suffix, [face](const EventPtr& e) { return e->GetCharge(face); });
+        for(const auto& g : globals)
+        {
+            define(g.name + suffix, [face, get = g.get, n = g.n](const EventPtr& e)
+            {
+                const Double_t* v = ((*e).*get)(face);
+                return RVecD(v, v + n);
+            });
+        }
+
+        if(tier == OutputTier::Triggered)
+        {
+            define("nTrg" + suffix, [face](const EventPtr& e)
+            {
+                const Bool_t* triggers = e->GetTriggers(face);
+                return (Int_t)count(triggers, triggers + CHANNELS, true);
+            });
+            define("TrgCh" + suffix, [face](const EventPtr& e)
+            {
+                RVecI trgCh;
+                const Bool_t* triggers = e->GetTriggers(face);
+                for(Int_t ch = 0; ch < CHANNELS; ch++)
+                {
+                    if(triggers[ch])
+                        trgCh.push_back(ch);
+                }
+                return trgCh;
+            });
+            for(const auto& c : channels)
+            {
+                define(string("Trg") + c.name + suffix, [face, get = c.get](const EventPtr& e)
+                {
+                    RVecD values;
+                    const Double_t* v = ((*e).*get)(face);
+                    const Bool_t* triggers = e->GetTriggers(face);
+                    for(Int_t ch = 0; ch < CHANNELS; ch++)
+                    {
+                        if(triggers[ch])
+                            values.push_back(v[ch]);
+                    }
+                    return values;
+                });
+            }
+        }
+        else if(tier == OutputTier::Full)
+        {
+            for(const auto& c : channels)
+            {
+                define(c.name + suffix, [face, get = c.get](const EventPtr& e)
+                {
+                    const Double_t* v = ((*e).*get)(face);
+                    return RVecD(v, v + CHANNELS);
+                });
+            }
+            define("Triggers" + suffix, [face](const EventPtr& e)
+            {
+                const Bool_t* v = e->GetTriggers(face);
+                return RVec<Bool_t>(v, v + CHANNELS);
+            });
+        }
+    }
+
+    return df;
+}
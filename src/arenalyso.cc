@@ -0,0 +1,60 @@
+#include "arenalyso.hh"
+
+#include <algorithm>
+
+using namespace std;
+
+
+ArenaLYSO& ArenaLYSO::GetThread()
+{
+    thread_local ArenaLYSO arena;
+    return arena;
+}
+
+
+
+void ArenaLYSO::NextBlock(size_t bytes)
+{
+    // Blocks after the current one hold nothing: the next one is reused if large enough
+    size_t next = fBlocks.empty() ? 0 : fBlock + 1;
+    if(next < fBlocks.size() && fBlocks[next].size() >= bytes)
+    {
+        fBlock = next;
+        fOffset = 0;
+        return;
+    }
+
+    size_t size = max(bytes, fBlocks.empty() ? MIN_BLOCK : 2*fBlocks.back().size());
+    fBlocks.resize(next);
+    fBlocks.emplace_back(size);
+    fBlock = next;
+    fOffset = 0;
+    nGrowths++;
+}
+
+
+
+void ArenaLYSO::Rewind(const Mark& mark)
+{
+    fBlock = mark.block;
+    fOffset = mark.offset;
+
+    // Empty: one block as large as all of them, for the next events
+    if(fBlock == 0 && fOffset == 0 && fBlocks.size() > 1)
+    {
+        size_t size = GetCapacity();
+        fBlocks.clear();
+        fBlocks.emplace_back(size);
+        nGrowths++;
+    }
+}
+
+
+
+size_t ArenaLYSO::GetCapacity() const
+{
+    size_t size = 0;
+    for(const auto& block : fBlocks)
+        size += block.size();
+    return size;
+}
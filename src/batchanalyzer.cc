@@ -0,0 +1,247 @@
+#include "batchanalyzer.hh"
+
+#include <fstream>
+#include <regex>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <glob.h>
+
+#include <TROOT.h>
+#include <TSystem.h>
+
+using namespace std;
+
+
+string GenerateOutputFilename(const string& barFilename)
+{
+    // Regular expression per estrarre XXXXX e Y (opzionale)
+    regex pattern(R"((?:^|\/)BarID_(\d+)(?:_t(\d+))?\.root$)");
+    smatch matches;
+
+    // Cerca il pattern
+    if(regex_search(barFilename, matches, pattern))
+    {
+        string id = matches[1];  // XXXXX
+        string suffix;
+
+        // Controlla se esiste il parametro Y e lo aggiunge al suffisso se presente
+        if(matches.size() > 2 && matches[2].matched)
+            suffix = "_t" + matches[2].str();  // "_tY"
+
+        // Costruisce il filename finale
+        return "RootFiles/AnalyzerID_" + id + suffix + ".root";
+    }
+
+    cerr << "Filename format not recognized: " << barFilename << endl;
+    return "";
+}
+
+
+
+vector<string> BatchAnalyzer::ExpandInputs(const string& spec)
+{
+    vector<string> files;
+
+    FileStat_t stat;
+    Bool_t exists = gSystem->GetPathInfo(spec.c_str(), stat) == 0;
+
+    if(exists && R_ISDIR(stat.fMode))
+    {
+        void* dir = gSystem->OpenDirectory(spec.c_str());
+        regex barPattern(R"(^BarID_\d+(?:_t\d+)?\.root$)");
+        while(const char* entry = gSystem->GetDirEntry(dir))
+        {
+            if(regex_match(entry, barPattern))
+                files.push_back(spec + "/" + entry);
+        }
+        gSystem->FreeDirectory(dir);
+        sort(files.begin(), files.end());
+    }
+    else if(spec.find_first_of("*?[") != string::npos)
+    {
+        glob_t matches;
+        if(glob(spec.c_str(), 0, nullptr, &matches) == 0)
+        {
+            for(size_t i = 0; i < matches.gl_pathc; i++)
+                files.push_back(matches.gl_pathv[i]);
+        }
+        globfree(&matches);
+    }
+    else if(exists && !(spec.size() > 5 && spec.compare(spec.size() - 5, 5, ".root") == 0))
+    {
+        ifstream list(spec);
+        string line;
+        while(getline(list, line))
+        {
+            line = regex_replace(line, regex("^\\s+|\\s+$"), "");
+            if(!line.empty() && line[0] != '#')
+                files.push_back(line);
+        }
+    }
+    else
+    {
+        files.push_back(spec);
+    }
+
+    return files;
+}
+
+
+
+BatchAnalyzer::BatchAnalyzer(const vector<string>& bars, const char* config)
+    : barFilenames(bars), configFilename(config)
+{
+}
+
+
+
+Bool_t BatchAnalyzer::Run()
+{
+    vector<Job> jobs;
+    Int_t nSkipped = 0;
+    atomic<Int_t> nFailed{0};
+
+    for(const auto& bar : barFilenames)
+    {
+        FileStat_t stat;
+        string output = GenerateOutputFilename(bar);
+        if(output.empty() || gSystem->GetPathInfo(bar.c_str(), stat) != 0)
+        {
+            cerr << "AnalyzerBatch>> Skipping " << bar << endl;
+            nFailed++;
+            continue;
+        }
+
+        Job job{bar, output, stat.fSize, stat.fMtime};
+        if(!isForced && IsUpToDate(job))
+        {
+            nSkipped++;
+            continue;
+        }
+        jobs.push_back(job);
+    }
+
+    // Largest first: the long jobs don't end up alone at the end
+    sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.size > b.size; });
+
+    Int_t nUsefulJobs = min<Int_t>(nJobs, jobs.size());
+    cout << "AnalyzerBatch>> " << jobs.size() << " files to analyze, " << nSkipped << " up to date, "
+         << TMath::Max(nUsefulJobs, 1) << " jobs" << endl;
+
+    if(nUsefulJobs > 1)
+        ROOT::EnableThreadSafety();
+
+    atomic<size_t> nextJob{0};
+    atomic<Long64_t> totEntries{0};
+    atomic<Long64_t> totBytes{0};
+    mutex printMutex;
+    size_t nDone = 0;
+    atomic<Int_t> nJobsFailed{0};
+
+    auto start = chrono::steady_clock::now();
+    auto worker = [&]()
+    {
+        for(size_t j = nextJob++; j < jobs.size(); j = nextJob++)
+        {
+            auto jobStart = chrono::steady_clock::now();
+            Long64_t nEntries = 0;
+            // With several jobs the per-file progress would be interleaved
+            Bool_t ok = RunJob(jobs[j], nUsefulJobs <= 1, nEntries);
+            chrono::duration<Double_t> elapsed = chrono::steady_clock::now() - jobStart;
+
+            if(ok)
+            {
+                totEntries += nEntries;
+                totBytes += jobs[j].size;
+            }
+            else
+            {
+                nFailed++;
+                nJobsFailed++;
+            }
+
+            lock_guard<mutex> lock(printMutex);
+            cout << "AnalyzerBatch>> [" << ++nDone << "/" << jobs.size() << "] " << jobs[j].barFilename;
+            if(ok)
+                cout << ": " << nEntries << " entries in " << elapsed.count() << " s -> " << jobs[j].outputFilename << endl;
+            else
+                cout << ": FAILED" << endl;
+        }
+    };
+
+    vector<thread> workers;
+    for(Int_t t = 1; t < nUsefulJobs; t++)
+        workers.emplace_back(worker);
+    worker();
+    for(auto& w : workers)
+        w.join();
+
+    chrono::duration<Double_t> elapsed = chrono::steady_clock::now() - start;
+    Double_t seconds = TMath::Max(elapsed.count(), 1e-9);
+
+    cout << "AnalyzerBatch>> Done: " << jobs.size() - nJobsFailed << " analyzed, " << nSkipped << " up to date, "
+         << nFailed << " failed" << endl;
+    cout << "AnalyzerBatch>> " << totEntries << " entries, " << totBytes / 1048576. << " MB in " << elapsed.count() << " s: "
+         << totEntries / seconds << " events/s, " << totBytes / 1048576. / seconds << " MB/s" << endl;
+
+    return nFailed == 0;
+}
+
+
+
+vector<string> BatchAnalyzer::GetOutputFilenames(const string& outputFilename) const
+{
+    if(scan.IsEmpty())
+        return {outputFilename};
+
+    vector<string> filenames;
+    for(Int_t k = 0; k < scan.GetSize(); k++)
+        filenames.push_back(scan.GetFilename(outputFilename, k));
+    return filenames;
+}
+
+
+
+Bool_t BatchAnalyzer::IsUpToDate(const Job& job) const
+{
+    FileStat_t output, config;
+    Long_t configMtime = gSystem->GetPathInfo(configFilename.c_str(), config) == 0 ? config.fMtime : 0;
+    for(const string& filename : GetOutputFilenames(job.outputFilename))
+    {
+        if(gSystem->GetPathInfo(filename.c_str(), output) != 0)
+            return false;
+        if(output.fMtime < job.mtime || output.fMtime < configMtime)
+            return false;
+    }
+    return true;
+}
+
+
+
+Bool_t BatchAnalyzer::RunJob(const Job& job, Bool_t isVerbose, Long64_t& nEntries)
+{
+    string stem = job.outputFilename.substr(0, job.outputFilename.size() - 5);
+    vector<string> tmpFilenames = GetOutputFilenames(stem + ".tmp.root");
+    vector<string> outputFilenames = GetOutputFilenames(job.outputFilename);
+
+    LoopAnalyzer loop(job.barFilename.c_str(), (stem + ".tmp.root").c_str());
+    if(loopOptions)
+        loopOptions(loop);
+    loop.SetVerbose(isVerbose);
+
+    Bool_t ok = loop.Run();
+    for(size_t k = 0; ok && k < tmpFilenames.size(); k++)
+        ok = gSystem->Rename(tmpFilenames[k].c_str(), outputFilenames[k].c_str()) == 0;
+    if(!ok)
+    {
+        for(const string& filename : tmpFilenames)
+            gSystem->Unlink(filename.c_str());
+        return false;
+    }
+
+    nEntries = loop.GetEntries();
+    return true;
+}
@@ -0,0 +1,346 @@
+#include "channelcachelyso.hh"
+#include "geometrylyso.hh"
+
+#include <vector>
+
+using namespace std;
+using namespace ROOT;
+
+
+// Buffer of one lyso_channels entry, bound to the branches
+struct ChannelCacheBuffer
+{
+    Int_t EventAZ;
+    Double_t Charges[FACES][CHANNELS];
+    Double_t Amplitudes[FACES][CHANNELS];
+    Double_t TimeCFs15[FACES][CHANNELS];
+    Double_t TimeCFs25[FACES][CHANNELS];
+    Double_t TimeCFs50[FACES][CHANNELS];
+    Bool_t Triggers[FACES][CHANNELS];
+    Double_t Baselines[FACES][CHANNELS];
+    // Waveforms around the channel of max amplitude, ascending channels
+    Int_t nWfs[FACES];
+    Int_t WfCh[FACES][CHANNELS];
+    Short_t WfStopCell[FACES][CHANNELS];
+    Float_t WfSamples[FACES][CHANNELS*SAMPLINGS];
+
+    // {name, leaflist, address}
+    struct Column { string name; string leaflist; void* address; };
+    vector<Column> columns;
+
+    ChannelCacheBuffer();
+    ChannelCacheBuffer(const ChannelCacheBuffer&) = delete;
+    ChannelCacheBuffer& operator=(const ChannelCacheBuffer&) = delete;
+};
+
+
+
+ChannelCacheBuffer::ChannelCacheBuffer()
+{
+    const char* const faceSuffix[FACES] = {"_F", "_B"};
+    const string n = "[" + to_string(CHANNELS) + "]";
+
+    columns.push_back({"EventAZ", "EventAZ/I", &EventAZ});
+    for(Int_t face = 0; face < FACES; face++)
+    {
+        string suffix = faceSuffix[face];
+        auto add = [this, &suffix](const string& name, const string& dims, void* address)
+        {
+            columns.push_back({name + suffix, name + suffix + dims, address});
+        };
+
+        add("Charges", n + "/D", Charges[face]);
+        add("Amplitudes", n + "/D", Amplitudes[face]);
+        add("TimeCFs15", n + "/D", TimeCFs15[face]);
+        add("TimeCFs25", n + "/D", TimeCFs25[face]);
+        add("TimeCFs50", n + "/D", TimeCFs50[face]);
+        add("Triggers", n + "/O", Triggers[face]);
+        add("Baselines", n + "/D", Baselines[face]);
+
+        string counter = "nWfs" + suffix;
+        add("nWfs", "/I", &nWfs[face]);
+        add("WfCh", "[" + counter + "]/I", WfCh[face]);
+        add("WfStopCell", "[" + counter + "]/S", WfStopCell[face]);
+        add("WfSamples", "[" + counter + "][" + to_string(SAMPLINGS) + "]/F", WfSamples[face]);
+    }
+}
+
+
+
+namespace
+{
+    class ChannelCacheOutput : public OutputLYSO
+    {
+      public:
+        ChannelCacheOutput(TFile* file, TimeCalibrationLYSO* calibration, Int_t nCircles)
+            : fFile(file), fCalibration(calibration), fCircles(nCircles), fBuffer(make_unique<ChannelCacheBuffer>())
+        {
+            fFile->cd();
+            fTree = make_unique<TTree>("lyso_channels", "TTree of lyso per-channel estimators");
+            for(const auto& c : fBuffer->columns)
+                fTree->Branch(c.name.c_str(), c.address, c.leaflist.c_str());
+        }
+
+        ~ChannelCacheOutput() override
+        {
+            // Seen by ChannelCacheFileLYSO::Close
+            fFile->cd();
+            if(fFile->WriteObject(fTree.get(), "lyso_channels") <= 0)
+                fFile->SetBit(TFile::kWriteError);
+        }
+
+        void Fill(const EventLYSO& event) override
+        {
+            ChannelCacheBuffer& b = *fBuffer;
+
+            b.EventAZ = event.GetEventID();
+            for(Int_t face = 0; face < FACES; face++)
+            {
+                copy_n(event.GetCharges(face), CHANNELS, b.Charges[face]);
+                copy_n(event.GetAmplitudes(face), CHANNELS, b.Amplitudes[face]);
+                copy_n(event.GetTimeCFs15(face), CHANNELS, b.TimeCFs15[face]);
+                copy_n(event.GetTimeCFs25(face), CHANNELS, b.TimeCFs25[face]);
+                copy_n(event.GetTimeCFs50(face), CHANNELS, b.TimeCFs50[face]);
+                copy_n(event.GetTriggers(face), CHANNELS, b.Triggers[face]);
+                copy_n(event.GetBaselines(face), CHANNELS, b.Baselines[face]);
+
+                // Same channel of max amplitude as MeasureDetectorTime
+                const Double_t* amplitudes = event.GetAmplitudes(face);
+                Int_t chAmpMax = max_element(amplitudes, amplitudes + CHANNELS) - amplitudes;
+
+                Int_t nChannels;
+                const Int_t* channels = GeometryLYSO::GetInstance()->GetNeighbors(chAmpMax, fCircles, nChannels);
+                b.nWfs[face] = nChannels;
+                for(Int_t k = 0; k < nChannels; k++)
+                {
+                    Int_t ch = channels[k];
+                    Int_t cell = fCalibration->FindStopCell(face, ch, event.GetTimes(face, ch));
+                    if(cell < 0)
+                    {
+                        if(!fWarned)
+                            cerr << "Time grids not from the calibration of the cache: stop cell 0 written" << endl;
+                        fWarned = true;
+                        cell = 0;
+                    }
+
+                    b.WfCh[face][k] = ch;
+                    b.WfStopCell[face][k] = cell;
+                    copy_n(event.GetSamples(face, ch), SAMPLINGS, b.WfSamples[face] + k*SAMPLINGS);
+                }
+            }
+
+            fTree->Fill();
+        }
+
+      private:
+        TFile* fFile;
+        TimeCalibrationLYSO* fCalibration;
+        Int_t fCircles;
+        unique_ptr<ChannelCacheBuffer> fBuffer;
+        unique_ptr<TTree> fTree;
+        Bool_t fWarned = false;
+    };
+
+
+
+    // lyso_channels_info, one entry per written file
+    struct ChannelCacheInfo
+    {
+        ULong64_t Hash;
+        Int_t Circles;
+        vector<Float_t> Times[FACES]; // stop cell 0 grids, [ch*SAMPLINGS + i]
+
+        ChannelCacheInfo()
+        {
+            for(Int_t face = 0; face < FACES; face++)
+                Times[face].resize(CHANNELS*SAMPLINGS);
+        }
+
+        template<class F>
+        void ForEachColumn(F f)
+        {
+            const string dims = "[" + to_string(CHANNELS) + "][" + to_string(SAMPLINGS) + "]/F";
+            f("Hash", "Hash/l", &Hash);
+            f("Circles", "Circles/I", &Circles);
+            f("Times_F", "Times_F" + dims, Times[0].data());
+            f("Times_B", "Times_B" + dims, Times[1].data());
+        }
+    };
+}
+
+
+
+unique_ptr<ChannelCacheFileLYSO> ChannelCacheFileLYSO::Create(const string& filename, shared_ptr<TimeCalibrationLYSO> calibration,
+                                                            const ParametersMPPC& par, Int_t nCircles)
+{
+    unique_ptr<ChannelCacheFileLYSO> cache(new ChannelCacheFileLYSO());
+    cache->file.reset(TFile::Open(filename.c_str(), "RECREATE"));
+    if(!cache->file || cache->file->IsZombie())
+    {
+        cerr << "Error opening file: " << filename << endl;
+        return nullptr;
+    }
+
+    cache->calibration = move(calibration);
+    cache->hash = par.GetHash();
+    cache->nCircles = TMath::Min(TMath::Max(nCircles, 0), MAX_CIRCLES);
+
+    return cache;
+}
+
+
+
+unique_ptr<OutputLYSO> ChannelCacheFileLYSO::CreateWriter()
+{
+    return make_unique<ChannelCacheOutput>(file.get(), calibration.get(), nCircles);
+}
+
+
+
+Bool_t ChannelCacheFileLYSO::Close()
+{
+    ChannelCacheInfo info;
+    info.Hash = hash;
+    info.Circles = nCircles;
+    for(Int_t face = 0; face < FACES; face++)
+    {
+        for(Int_t ch = 0; ch < CHANNELS; ch++)
+            copy_n(calibration->GetTimes(face, ch), SAMPLINGS, info.Times[face].data() + ch*SAMPLINGS);
+    }
+
+    // Gone before the file is closed, as the writers
+    {
+        file->cd();
+        auto infoTree = make_unique<TTree>("lyso_channels_info", "TTree of lyso per-channel cache info");
+        info.ForEachColumn([&infoTree](const string& name, const string& leaflist, void* address)
+        {
+            infoTree->Branch(name.c_str(), address, leaflist.c_str());
+        });
+        infoTree->Fill();
+        if(file->WriteObject(infoTree.get(), "lyso_channels_info") <= 0)
+            file->SetBit(TFile::kWriteError);
+    }
+
+    // Write errors of the writers, of the info and of the keys at Close
+    Bool_t ok = !file->TestBit(TFile::kWriteError);
+    file->Close();
+    ok = ok && !file->TestBit(TFile::kWriteError);
+    if(!ok)
+        cerr << "Error writing file: " << file->GetName() << endl;
+    return ok;
+}
+
+
+
+ChannelCacheLYSO::ChannelCacheLYSO(const char* cacheFilename)
+{
+    cacheFile.reset(TFile::Open(cacheFilename, "READ"));
+    if(!cacheFile || cacheFile->IsZombie())
+    {
+        cerr << "Error opening file: " << cacheFilename << endl;
+        return;
+    }
+
+    auto channels = cacheFile->Get<TTree>("lyso_channels");
+    unique_ptr<TTree> infoTree(cacheFile->Get<TTree>("lyso_channels_info"));
+    if(!channels || !infoTree || infoTree->GetEntries() < 1)
+    {
+        cerr << "Trees lyso_channels/lyso_channels_info not found in: " << cacheFilename << endl;
+        delete channels;
+        return;
+    }
+
+    // Merged caches have one info entry per part: they must agree
+    ChannelCacheInfo info;
+    info.ForEachColumn([&infoTree](const string& name, const string&, auto* address)
+    {
+        infoTree->SetBranchAddress(name.c_str(), address);
+    });
+    infoTree->GetEntry(0);
+    hash = info.Hash;
+    nCircles = info.Circles;
+    for(Long64_t k = 1; k < infoTree->GetEntries(); k++)
+    {
+        infoTree->GetEntry(k);
+        if(info.Hash != hash || info.Circles != nCircles)
+        {
+            cerr << "Parts of " << cacheFilename << " from different configurations" << endl;
+            delete channels;
+            return;
+        }
+    }
+    infoTree->GetEntry(0);
+
+    vector<RVecF> times[FACES];
+    for(Int_t face = 0; face < FACES; face++)
+    {
+        for(Int_t ch = 0; ch < CHANNELS; ch++)
+        {
+            const Float_t* t = info.Times[face].data() + ch*SAMPLINGS;
+            times[face].emplace_back(t, t + SAMPLINGS);
+        }
+    }
+    calibration = make_unique<TimeCalibrationLYSO>(times[0], times[1]);
+
+    // One event and one buffer for all the entries
+    const Float_t* grids[FACES*CHANNELS];
+    for(Int_t face = 0; face < FACES; face++)
+    {
+        for(Int_t ch = 0; ch < CHANNELS; ch++)
+            grids[face*CHANNELS + ch] = calibration->GetTimes(face, ch);
+    }
+    event = make_unique<EventLYSO>(0, grids, AlignedVector<Float_t>(FACES*CHANNELS*SAMPLINGS, 0.f));
+
+    buffer = make_unique<ChannelCacheBuffer>();
+    for(const auto& c : buffer->columns)
+        channels->SetBranchAddress(c.name.c_str(), c.address);
+
+    lyso_channels = channels;
+    nEntries = lyso_channels->GetEntries();
+}
+
+
+
+ChannelCacheLYSO::~ChannelCacheLYSO()
+{
+    delete lyso_channels;
+}
+
+
+
+EventLYSO& ChannelCacheLYSO::GetEntry(Long64_t k)
+{
+    lyso_channels->GetEntry(k);
+
+    const ChannelCacheBuffer& b = *buffer;
+    EventLYSO& e = *event;
+    Double_t* charges[FACES] = {e.Charges_F, e.Charges_B};
+    Double_t* amplitudes[FACES] = {e.Amplitudes_F, e.Amplitudes_B};
+    Double_t* timeCFs15[FACES] = {e.TimeCFs15_F, e.TimeCFs15_B};
+    Double_t* timeCFs25[FACES] = {e.TimeCFs25_F, e.TimeCFs25_B};
+    Double_t* timeCFs50[FACES] = {e.TimeCFs50_F, e.TimeCFs50_B};
+    Bool_t* triggers[FACES] = {e.Triggers_F, e.Triggers_B};
+
+    e.EventAZ = b.EventAZ;
+    for(Int_t face = 0; face < FACES; face++)
+    {
+        copy_n(b.Charges[face], CHANNELS, charges[face]);
+        copy_n(b.Amplitudes[face], CHANNELS, amplitudes[face]);
+        copy_n(b.TimeCFs15[face], CHANNELS, timeCFs15[face]);
+        copy_n(b.TimeCFs25[face], CHANNELS, timeCFs25[face]);
+        copy_n(b.TimeCFs50[face], CHANNELS, timeCFs50[face]);
+        copy_n(b.Triggers[face], CHANNELS, triggers[face]);
+        copy_n(b.Baselines[face], CHANNELS, e.fBaselines[face]);
+
+        // Only the cached waveforms are up to date in the event buffer
+        for(Int_t k = 0; k < b.nWfs[face]; k++)
+        {
+            Int_t ch = b.WfCh[face][k];
+            Int_t cell = b.WfStopCell[face][k];
+            e.fTimes[face*CHANNELS + ch] = calibration->GetTimes(face, ch, cell >= 0 && cell < SAMPLINGS ? cell : 0);
+            copy_n(b.WfSamples[face] + k*SAMPLINGS, SAMPLINGS, e.fSamples.data() + (face*CHANNELS + ch)*SAMPLINGS);
+        }
+    }
+
+    return e;
+}
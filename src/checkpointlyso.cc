@@ -0,0 +1,210 @@
+#include "checkpointlyso.hh"
+#include "shardlyso.hh"
+
+#include <fstream>
+#include <sstream>
+
+#include <TSystem.h>
+
+using namespace std;
+
+
+CheckpointLYSO::CheckpointLYSO(const string& output, const string& bar, const string& uuid, Long64_t firstEntry, Long64_t lastEntry, ULong64_t hash)
+    : outputFilename(output), barFilename(bar), inputUUID(uuid), first(firstEntry), last(lastEntry), runHash(hash), committed(firstEntry)
+{
+    FileStat_t stat;
+    if(gSystem->GetPathInfo(barFilename.c_str(), stat) == 0)
+    {
+        inputSize = stat.fSize;
+        inputMtime = stat.fMtime;
+    }
+
+    if(!Load())
+    {
+        committed = first;
+        chunkStarts.clear();
+        isComplete = false;
+    }
+}
+
+
+
+string CheckpointLYSO::GetChunkFilename(Long64_t start) const
+{
+    return ShardFilename(outputFilename, "ckpt" + to_string(start));
+}
+
+
+
+Bool_t CheckpointLYSO::Commit(Long64_t start, Long64_t end)
+{
+    if(start != committed)
+        return false;
+
+    if(!WriteShardInfo(GetChunkFilename(start), {start, end, last, inputUUID}))
+        return false;
+
+    chunkStarts.push_back(start);
+    committed = end;
+
+    return Save();
+}
+
+
+
+Bool_t CheckpointLYSO::Finalize()
+{
+    if(isComplete)
+        return true;
+
+    vector<string> chunks;
+    for(auto start : chunkStarts)
+        chunks.push_back(GetChunkFilename(start));
+
+    Bool_t ok;
+    if(chunks.size() == 1)
+        ok = gSystem->Rename(chunks[0].c_str(), outputFilename.c_str()) == 0;
+    else
+        ok = MergeShards(outputFilename, chunks);
+
+    if(!ok)
+    {
+        cerr << "Error merging the checkpoints into: " << outputFilename << endl;
+        return false;
+    }
+
+    for(const auto& c : chunks)
+        gSystem->Unlink(c.c_str());
+
+    isComplete = true;
+    return Save();
+}
+
+
+
+void CheckpointLYSO::Remove(const string& output)
+{
+    gSystem->Unlink(RecordFilename(output).c_str());
+}
+
+
+
+string CheckpointLYSO::RecordFilename(const string& output)
+{
+    string stem = output;
+    if(stem.size() > 5 && stem.compare(stem.size() - 5, 5, ".root") == 0)
+        stem.resize(stem.size() - 5);
+
+    return stem + ".progress";
+}
+
+
+
+Bool_t CheckpointLYSO::Load()
+{
+    ifstream file(RecordFilename(outputFilename));
+    if(!file.is_open())
+        return false;
+
+    string line, recordInput;
+    Long64_t recordSize = -1, recordFirst = -1, recordLast = -1;
+    Long_t recordMtime = -1;
+    ULong64_t recordHash = 0;
+
+    while(getline(file, line))
+    {
+        if(line.empty() || line[0] == '#')
+            continue;
+
+        size_t equalPos = line.find(" = ");
+        if(equalPos == string::npos)
+            continue;
+        string name = line.substr(0, equalPos);
+        istringstream value(line.substr(equalPos + 3));
+
+        if(name == "input")
+            recordInput = value.str();
+        else if(name == "inputSize")
+            value >> recordSize;
+        else if(name == "inputMtime")
+            value >> recordMtime;
+        else if(name == "runHash")
+            value >> hex >> recordHash;
+        else if(name == "first")
+            value >> recordFirst;
+        else if(name == "last")
+            value >> recordLast;
+        else if(name == "committed")
+            value >> committed;
+        else if(name == "chunk")
+        {
+            Long64_t start;
+            value >> start;
+            chunkStarts.push_back(start);
+        }
+        else if(name == "complete")
+            value >> isComplete;
+    }
+
+    if(recordInput != barFilename || recordSize != inputSize || recordMtime != inputMtime || recordHash != runHash
+       || recordFirst != first || recordLast != last)
+    {
+        cerr << "Progress record of " << outputFilename << " does not match this run: starting over" << endl;
+        for(auto start : chunkStarts)
+            gSystem->Unlink(GetChunkFilename(start).c_str());
+        return false;
+    }
+
+    // The output or the chunks may be gone since
+    if(isComplete)
+        return !gSystem->AccessPathName(outputFilename.c_str());
+
+    Long64_t expected = first;
+    for(auto start : chunkStarts)
+    {
+        ShardInfo info;
+        if(start != expected || !ReadShardInfo(GetChunkFilename(start), info) || info.first != start)
+        {
+            cerr << "Checkpoint " << GetChunkFilename(start) << " not valid: starting over" << endl;
+            return false;
+        }
+        expected = info.last;
+    }
+
+    return expected == committed;
+}
+
+
+
+Bool_t CheckpointLYSO::Save() const
+{
+    // Written aside and renamed: the record is never partial
+    string recordFilename = RecordFilename(outputFilename);
+    string tmpFilename = recordFilename + ".tmp";
+    {
+        ofstream file(tmpFilename);
+        if(!file.is_open())
+        {
+            cerr << "Error opening file: " << tmpFilename << endl;
+            return false;
+        }
+
+        file << "# Progress of analyzer_lyso, see CheckpointLYSO" << endl;
+        file << "input = " << barFilename << endl;
+        file << "inputSize = " << inputSize << endl;
+        file << "inputMtime = " << inputMtime << endl;
+        file << "runHash = " << hex << runHash << dec << endl;
+        file << "first = " << first << endl;
+        file << "last = " << last << endl;
+        file << "committed = " << committed << endl;
+        for(auto start : chunkStarts)
+            file << "chunk = " << start << endl;
+        file << "complete = " << isComplete << endl;
+
+        file.flush();
+        if(!file)
+            return false;
+    }
+
+    return gSystem->Rename(tmpFilename.c_str(), recordFilename.c_str()) == 0;
+}
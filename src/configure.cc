@@ -69,6 +69,10 @@ void ConfigAnalyzer::LoadConfig(const char* filename)
         {
             nCircles_Position = stoi(paramValue);
         }
+        else if(paramName == "outputTier")
+        {
+            outputTier = paramValue;
+        }
         else
         {
             cerr << "Unknown parameter: " << paramName << endl;
@@ -89,5 +93,31 @@ void ConfigAnalyzer::PrintDebug() const
     cout << "upInt: " << upInt << endl;
     cout << "nCircles_Time: " << nCircles_Time << endl;
     cout << "nCircles_Position: " << nCircles_Position << endl;
+    cout << "outputTier: " << outputTier << endl;
+}
+
+
+
+ULong64_t ConfigAnalyzer::GetHash() const
+{
+    ostringstream params;
+    params.precision(9);
+    params << trgLevel << ";" << lowBase << ";" << upBase << ";" << lowInt << ";" << upInt << ";"
+           << nCircles_Time << ";" << nCircles_Position << ";" << outputTier;
+
+    return HashFNV1a(params.str());
 }
 
+
+
+ULong64_t HashFNV1a(const string& text)
+{
+    ULong64_t hash = 14695981039346656037ULL;
+    for(char c : text)
+    {
+        hash ^= (unsigned char)c;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
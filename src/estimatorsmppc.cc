@@ -0,0 +1,220 @@
+#include "estimatorsmppc.hh"
+#include "simdmppc.hh"
+
+using namespace std;
+
+
+ParametersMPPC ParametersMPPC::FromConfig()
+{
+    auto config = ConfigAnalyzer::GetInstance();
+
+    ParametersMPPC par;
+    par.trgLevel = config->trgLevel;
+    par.lowBase = config->lowBase;
+    par.upBase = config->upBase;
+    par.lowInt = config->lowInt;
+    par.upInt = config->upInt;
+
+    if(par.lowBase >= par.upBase)
+        cerr << "Limits not valid!" << endl;
+
+    return par;
+}
+
+
+
+ULong64_t ParametersMPPC::GetHash() const
+{
+    ostringstream params;
+    params.precision(9);
+    params << trgLevel << ";" << lowBase << ";" << upBase << ";" << lowInt << ";" << upInt;
+    for(Int_t i = 0; i < nFractions; i++)
+        params << ";" << fractions[i];
+
+    return HashFNV1a(params.str());
+}
+
+
+
+template<typename T>
+void MeasureEstimatorsMPPC(const T* t, const T* w, const ParametersMPPC& par, EstimatorsMPPC& est)
+{
+    if(DefaultShapeMPPC::Matches(par))
+    {
+        MeasureWindowsMPPC(t, w, par, DefaultShapeMPPC(), est);
+        MeasureTimesCFMPPC(t, w, par, DefaultShapeMPPC(), est);
+    }
+    else
+    {
+        MeasureWindowsMPPC(t, w, par, DynamicShapeMPPC{par}, est);
+        MeasureTimesCFMPPC(t, w, par, DynamicShapeMPPC{par}, est);
+    }
+}
+
+
+
+template<typename T>
+void MeasureWindowsMPPC(const T* t, const T* w, const ParametersMPPC& par, EstimatorsMPPC& est)
+{
+    if(DefaultShapeMPPC::Matches(par))
+        MeasureWindowsMPPC(t, w, par, DefaultShapeMPPC(), est);
+    else
+        MeasureWindowsMPPC(t, w, par, DynamicShapeMPPC{par}, est);
+}
+
+
+
+template<typename T>
+void MeasureTimesCFMPPC(const T* t, const T* w, const ParametersMPPC& par, EstimatorsMPPC& est)
+{
+    if(DefaultShapeMPPC::Matches(par))
+        MeasureTimesCFMPPC(t, w, par, DefaultShapeMPPC(), est);
+    else
+        MeasureTimesCFMPPC(t, w, par, DynamicShapeMPPC{par}, est);
+}
+
+
+
+template<typename T>
+void MeasureIntegralMPPC(const T* t, const T* w, const ParametersMPPC& par, EstimatorsMPPC& est)
+{
+    if(DefaultShapeMPPC::Matches(par))
+        MeasureIntegralMPPC(t, w, par, DefaultShapeMPPC(), est);
+    else
+        MeasureIntegralMPPC(t, w, par, DynamicShapeMPPC{par}, est);
+}
+
+
+
+template<typename T, typename Shape>
+void MeasureWindowsMPPC(const T* t, const T* w, const ParametersMPPC& par, const Shape& shape, EstimatorsMPPC& est)
+{
+    // Sweep 1: baseline and noise, same double accumulation as VecOps::Mean and VecOps::StdDev
+    Double_t sum = 0, sumSquares = 0;
+    for(Int_t i = shape.LowBase(); i <= shape.UpBase(); i++)
+    {
+        Double_t x = w[i];
+        sum += x;
+        sumSquares += x*x;
+    }
+    SetBaselineMPPC(sum, sumSquares, shape, est);
+
+    MeasureIntegralMPPC(t, w, par, shape, est);
+}
+
+
+
+template<typename T, typename Shape>
+void MeasureIntegralMPPC(const T* t, const T* w, const ParametersMPPC& par, const Shape& shape, EstimatorsMPPC& est)
+{
+    const Double_t baseline = est.baseline;
+
+    // Sweep 2: charge (trapezoids) and amplitude over [lowInt, upInt]
+    Double_t charge = 0;
+    Double_t amplitude = baseline - Double_t(w[shape.LowInt()]);
+    for(Int_t i = shape.LowInt(); i < shape.UpInt(); i++)
+    {
+        charge += (2*baseline - (Double_t(w[i]) + Double_t(w[i+1])))*(Double_t(t[i+1]) - Double_t(t[i]))*0.5;
+        amplitude = TMath::Max(amplitude, baseline - Double_t(w[i+1]));
+    }
+
+    est.charge = charge;
+    est.amplitude = amplitude;
+    est.trigger = amplitude > -par.trgLevel;
+}
+
+
+
+template<typename T, typename Shape>
+void MeasureTimesCFMPPC(const T* t, const T* w, const ParametersMPPC& par, const Shape& shape, EstimatorsMPPC& est)
+{
+    constexpr Int_t lastBin = SAMPLINGS - 1;
+    constexpr Int_t zeroBin = ZERO_TIME_BIN;
+
+    const Double_t baseline = est.baseline;
+    const Double_t amplitude = est.amplitude;
+
+    if(!est.trigger)
+    {
+        est.trgCell = -1;
+        for(Int_t j = 0; j < shape.NFractions(); j++)
+            est.timeCF[j] = -1;
+        return;
+    }
+
+    // Sweep 3: CF times. Before the trigger cell every sample is above the
+    // trigger level, so the first crossing after ZERO_TIME_BIN of a threshold
+    // below it is also the first one after the trigger cell: one forward
+    // sweep finds the trigger cell and all of them
+    const Double_t trgValue = baseline + par.trgLevel;
+
+    Double_t thr[MAX_FRACTIONS];
+    Int_t binInf[MAX_FRACTIONS], binSup[MAX_FRACTIONS];
+    Double_t sweepValues[MAX_FRACTIONS + 1] = {trgValue};
+    Int_t sweepBins[MAX_FRACTIONS + 1];
+    Int_t sweepIndex[MAX_FRACTIONS];
+    Int_t nSweep = 1;
+    for(Int_t j = 0; j < shape.NFractions(); j++)
+    {
+        thr[j] = baseline - amplitude*shape.Fraction(j);
+        binInf[j] = binSup[j] = -1;
+        sweepIndex[j] = -1;
+        if(thr[j] < trgValue)
+        {
+            sweepIndex[j] = nSweep;
+            sweepValues[nSweep++] = thr[j];
+        }
+    }
+
+    FindCrossingsMPPC(w, sweepValues, nSweep, zeroBin, lastBin, sweepBins);
+    const Int_t trgCell = sweepBins[0];
+    est.trgCell = trgCell;
+
+    for(Int_t j = 0; trgCell >= 0 && j < shape.NFractions(); j++)
+    {
+        if(sweepIndex[j] >= 0)
+        {
+            binSup[j] = sweepBins[sweepIndex[j]];
+            binInf[j] = FindCrossingMPPC(w, thr[j], true, binSup[j], zeroBin);
+        }
+        else
+        {
+            binInf[j] = FindCrossingMPPC(w, thr[j], true, trgCell, zeroBin);
+            binSup[j] = FindCrossingMPPC(w, thr[j], false, binInf[j], lastBin);
+        }
+    }
+
+    for(Int_t j = 0; j < shape.NFractions(); j++)
+    {
+        if(binInf[j] < 0 || binSup[j] < 0)
+        {
+            cerr << "ERROR! CROSSING POINT NOT FOUND for value: " << thr[j] << ", starting from bin: " << trgCell << endl;
+            est.timeCF[j] = -1;
+            continue;
+        }
+
+        // Linear interpolation
+        Double_t tInf = t[binInf[j]], wInf = w[binInf[j]];
+        Double_t tSup = t[binSup[j]], wSup = w[binSup[j]];
+        est.timeCF[j] = ((thr[j] - wInf)/(wSup - wInf))*(tSup - tInf) + tInf;
+
+        if(est.timeCF[j] < 0.0)
+        {
+            cerr << "Le PROBLEM for frac = " << TMath::Nint(shape.Fraction(j)*100) << "Threshold at " << thr[j] << " Estimation at = " << est.timeCF[j] << endl;
+        }
+    }
+}
+
+
+template void MeasureEstimatorsMPPC<Float_t>(const Float_t*, const Float_t*, const ParametersMPPC&, EstimatorsMPPC&);
+template void MeasureEstimatorsMPPC<Double_t>(const Double_t*, const Double_t*, const ParametersMPPC&, EstimatorsMPPC&);
+template void MeasureWindowsMPPC<Float_t>(const Float_t*, const Float_t*, const ParametersMPPC&, EstimatorsMPPC&);
+template void MeasureWindowsMPPC<Double_t>(const Double_t*, const Double_t*, const ParametersMPPC&, EstimatorsMPPC&);
+template void MeasureTimesCFMPPC<Float_t>(const Float_t*, const Float_t*, const ParametersMPPC&, EstimatorsMPPC&);
+template void MeasureTimesCFMPPC<Double_t>(const Double_t*, const Double_t*, const ParametersMPPC&, EstimatorsMPPC&);
+template void MeasureIntegralMPPC<Float_t>(const Float_t*, const Float_t*, const ParametersMPPC&, EstimatorsMPPC&);
+template void MeasureIntegralMPPC<Double_t>(const Double_t*, const Double_t*, const ParametersMPPC&, EstimatorsMPPC&);
+template void MeasureWindowsMPPC<Float_t, DynamicShapeMPPC>(const Float_t*, const Float_t*, const ParametersMPPC&, const DynamicShapeMPPC&, EstimatorsMPPC&);
+template void MeasureWindowsMPPC<Float_t, DefaultShapeMPPC>(const Float_t*, const Float_t*, const ParametersMPPC&, const DefaultShapeMPPC&, EstimatorsMPPC&);
+template void MeasureTimesCFMPPC<Float_t, DynamicShapeMPPC>(const Float_t*, const Float_t*, const ParametersMPPC&, const DynamicShapeMPPC&, EstimatorsMPPC&);
+template void MeasureTimesCFMPPC<Float_t, DefaultShapeMPPC>(const Float_t*, const Float_t*, const ParametersMPPC&, const DefaultShapeMPPC&, EstimatorsMPPC&);
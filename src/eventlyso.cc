@@ -1,107 +1,339 @@
 #include "eventlyso.hh"
+#include "simdmppc.hh"
+#include "metricslyso.hh"
+#include "arenalyso.hh"
 
 using namespace std;
 using namespace ROOT;
 using namespace ROOT::VecOps;
 
 
-EventLYSO::EventLYSO(Int_t evtID, vector<RVecD> times_F, vector<RVecD> times_B, vector<RVecD> volts_F, vector<RVecD> volts_B)
-    : EventAZ(evtID), Front(CHANNELS), Back(CHANNELS), fCharges_F(CHANNELS), fCharges_B(CHANNELS), fAmplitudes_F(CHANNELS), fAmplitudes_B(CHANNELS), fTimeCFs15_F(CHANNELS), fTimeCFs15_B(CHANNELS), fTimeCFs25_F(CHANNELS), fTimeCFs25_B(CHANNELS), fTimeCFs50_F(CHANNELS), fTimeCFs50_B(CHANNELS),
-    fTrigger_F(CHANNELS), fTrigger_B(CHANNELS)
+namespace
 {
-    for(Int_t i = 0; i < CHANNELS; i++)
+    // Channels of the list (all of them if null) with the trigger on, in the
+    // same order, as a view on out. Same as Intersect(channels, Nonzero(triggers))
+    RVecI SelectTriggered(const Bool_t* triggers, const Int_t* channels, Int_t n, Int_t* out)
     {
-        Front[i] = WaveformMPPC(i, times_F[i], volts_F[i]);
-        Back[i] = WaveformMPPC(i, times_B[i], volts_B[i]);
+        Int_t size = 0;
+        for(Int_t k = 0; k < n; k++)
+        {
+            Int_t ch = channels ? channels[k] : k;
+            if(triggers[ch])
+                out[size++] = ch;
+        }
+        return RVecI(out, size);
+    }
+
+
+
+    // Min(Take(x, channels)), -1 (as an untriggered CF time) without channels
+    Double_t MinOf(const Double_t* x, const RVecI& channels)
+    {
+        if(channels.empty())
+            return -1;
+        Double_t min = x[channels[0]];
+        for(auto ch : channels)
+            min = TMath::Min(min, x[ch]);
+        return min;
+    }
+
+
+
+    // Mean(Take(x, channels)), same order of the sum
+    Double_t MeanOf(const Double_t* x, const RVecI& channels)
+    {
+        if(channels.empty())
+            return 0;
+        Double_t sum = 0;
+        for(auto ch : channels)
+            sum += x[ch];
+        return sum/channels.size();
+    }
+
+
+
+    // Sum(Take(x*w, channels)) / Sum(Take(w, channels)), same order of the sums
+    Double_t WeightedMeanOf(const Double_t* x, const Double_t* w, const RVecI& channels)
+    {
+        Double_t sumXW = 0, sumW = 0;
+        for(auto ch : channels)
+        {
+            sumXW += x[ch]*w[ch];
+            sumW += w[ch];
+        }
+        return sumXW/sumW;
     }
 }
 
 
 
-void EventLYSO::CalculateEstimatorsForEveryMPPC()
+EventLYSO::EventLYSO(Int_t evtID, const vector<RVecF>& times_F, const vector<RVecF>& times_B, const vector<RVecF>& volts_F, const vector<RVecF>& volts_B)
 {
-    for(Int_t i = 0; i < CHANNELS; i++)
+    const vector<RVecF>* timesByFace[FACES] = {&times_F, &times_B};
+    const Float_t* times[FACES*CHANNELS];
+
+    for(Int_t face = 0; face < FACES; face++)
     {
-        Front[i].MeasureCharge();
-        Front[i].MeasureAmplitude();
-        Front[i].MeasureTimeCF(0.15, 15);
-        Front[i].MeasureTimeCF(0.25, 25);
-        Front[i].MeasureTimeCF(0.50, 50);
-
-        Back[i].MeasureCharge();
-        Back[i].MeasureAmplitude();
-        Back[i].MeasureTimeCF(0.15, 15);
-        Back[i].MeasureTimeCF(0.25, 25);
-        Back[i].MeasureTimeCF(0.50, 50);
+        for(Int_t i = 0; i < CHANNELS; i++)
+            times[face*CHANNELS + i] = (*timesByFace[face])[i].data();
     }
 
-    FillEstimatorsVectors();
+    Load(evtID, times, volts_F, volts_B);
 }
 
 
 
-void EventLYSO::FillEstimatorsVectors()
+EventLYSO::EventLYSO(Int_t evtID, const Float_t* const times[], const vector<RVecF>& volts_F, const vector<RVecF>& volts_B)
 {
-    for(Int_t i = 0; i < CHANNELS; i++)
+    Load(evtID, times, volts_F, volts_B);
+}
+
+
+
+EventLYSO::EventLYSO(Int_t evtID, const Float_t* const times[], AlignedVector<Float_t>&& samples)
+{
+    Load(evtID, times, move(samples));
+}
+
+
+
+void EventLYSO::Load(Int_t evtID, const Float_t* const times[], const vector<RVecF>& volts_F, const vector<RVecF>& volts_B)
+{
+    EventAZ = evtID;
+    copy_n(times, FACES*CHANNELS, fTimes);
+
+    // Allocated the first time, or after ReleaseSamples
+    fSamples.resize(FACES*CHANNELS*SAMPLINGS);
+    PackSamples(volts_F, volts_B, fSamples.data());
+}
+
+
+
+void EventLYSO::Load(Int_t evtID, const Float_t* const times[], AlignedVector<Float_t>&& samples)
+{
+    EventAZ = evtID;
+    copy_n(times, FACES*CHANNELS, fTimes);
+
+    // The previous buffer, if any, goes back to the caller: never freed
+    fSamples.swap(samples);
+}
+
+
+
+void EventLYSO::PackSamples(const vector<RVecF>& volts_F, const vector<RVecF>& volts_B, Float_t* samples)
+{
+    const vector<RVecF>* volts[FACES] = {&volts_F, &volts_B};
+
+    for(Int_t face = 0; face < FACES; face++)
     {
-        fCharges_F[i] = Front[i].GetCharge();
-        fAmplitudes_F[i] = Front[i].GetAmplitude();
-        fTimeCFs15_F[i] = Front[i].GetTimeCF15();
-        fTimeCFs25_F[i] = Front[i].GetTimeCF25();
-        fTimeCFs50_F[i] = Front[i].GetTimeCF50();
-        fTrigger_F[i] = Front[i].GetTrigger();
-        
-        fCharges_B[i] = Back[i].GetCharge();
-        fAmplitudes_B[i] = Back[i].GetAmplitude();
-        fTimeCFs15_B[i] = Back[i].GetTimeCF15();
-        fTimeCFs25_B[i] = Back[i].GetTimeCF25();
-        fTimeCFs50_B[i] = Back[i].GetTimeCF50();
-        fTrigger_B[i] = Back[i].GetTrigger();
+        for(Int_t i = 0; i < CHANNELS; i++)
+        {
+            const RVecF& v = (*volts[face])[i];
+            Int_t n = min<size_t>(v.size(), SAMPLINGS);
+            Float_t* out = samples + (face*CHANNELS + i)*SAMPLINGS;
+            copy_n(v.begin(), n, out);
+            // Short waveforms: zeros, the buffer may be reused
+            fill(out + n, out + SAMPLINGS, 0.f);
+        }
     }
 }
 
 
 
-RVecI EventLYSO::FindFirstNeighbors(Int_t meanCh, Int_t nCircles)
+void EventLYSO::CalculateEstimatorsForEveryMPPC(const ParametersMPPC& par)
 {
-    // Note! It returns meanCh ITSELF plus the neighbors
-    if(nCircles < 0)
+    Double_t* charges[FACES] = {Charges_F, Charges_B};
+    Double_t* amplitudes[FACES] = {Amplitudes_F, Amplitudes_B};
+    Double_t* timeCFs15[FACES] = {TimeCFs15_F, TimeCFs15_B};
+    Double_t* timeCFs25[FACES] = {TimeCFs25_F, TimeCFs25_B};
+    Double_t* timeCFs50[FACES] = {TimeCFs50_F, TimeCFs50_B};
+    Bool_t* triggers[FACES] = {Triggers_F, Triggers_B};
+
+    // Sweeps 1-2 of the fused kernel for all channels at once (SIMD across
+    // channels), then the CF times channel by channel
+    const Float_t* times[FACES*CHANNELS];
+    const Float_t* samples[FACES*CHANNELS];
+    EstimatorsMPPC est[FACES*CHANNELS];
+
+    for(Int_t k = 0; k < FACES*CHANNELS; k++)
     {
-        nCircles = 0;
-        cerr << "Invalid nCircles, minimum is 0! Fixed to default value = 0" << endl;
+        times[k] = fTimes[k];
+        samples[k] = fSamples.data() + k*SAMPLINGS;
     }
-    Double_t epsilon = 0.01;
-    
-    Double_t xMax = nCircles*xSideDet + epsilon;
-    Double_t yMax = nCircles*ySideDet + epsilon;
 
-    RVecI channels = Range(115);
-    RVecD distX = abs(detX-detX[meanCh]);
-    RVecD distY = abs(detY-detY[meanCh]);
-    
-    return Take(channels, Nonzero(distX < xMax && distY < yMax));
+    {
+        KernelScopeLYSO scope(KernelLYSO::Windows, FACES*CHANNELS);
+        MeasureWindowsMPPC(times, samples, FACES*CHANNELS, par, est);
+    }
+
+    // Write straight into the estimator columns. Fractions are 15%, 25%, 50% in this order
+    KernelScopeLYSO scope(KernelLYSO::TimesCF, FACES*CHANNELS);
+    for(Int_t face = 0; face < FACES; face++)
+    {
+        for(Int_t i = 0; i < CHANNELS; i++)
+        {
+            EstimatorsMPPC& e = est[face*CHANNELS + i];
+            MeasureTimesCFMPPC(GetTimes(face, i), GetSamples(face, i), par, e);
+
+            fBaselines[face][i] = e.baseline;
+            charges[face][i] = e.charge;
+            amplitudes[face][i] = e.amplitude;
+            timeCFs15[face][i] = e.timeCF[0];
+            timeCFs25[face][i] = e.timeCF[1];
+            timeCFs50[face][i] = e.timeCF[2];
+            triggers[face][i] = e.trigger;
+        }
+    }
+}
+
+
+
+void EventLYSO::UpdateTriggersForEveryMPPC(const ParametersMPPC& par)
+{
+    const Double_t* charges[FACES] = {Charges_F, Charges_B};
+    const Double_t* amplitudes[FACES] = {Amplitudes_F, Amplitudes_B};
+    Double_t* timeCFs15[FACES] = {TimeCFs15_F, TimeCFs15_B};
+    Double_t* timeCFs25[FACES] = {TimeCFs25_F, TimeCFs25_B};
+    Double_t* timeCFs50[FACES] = {TimeCFs50_F, TimeCFs50_B};
+    Bool_t* triggers[FACES] = {Triggers_F, Triggers_B};
+
+    KernelScopeLYSO scope(KernelLYSO::TimesCF, FACES*CHANNELS);
+    for(Int_t face = 0; face < FACES; face++)
+    {
+        for(Int_t i = 0; i < CHANNELS; i++)
+        {
+            // Sweeps 1-2 as left by the kernel, same trigger as SetChargesAmplitudes
+            EstimatorsMPPC e;
+            e.baseline = fBaselines[face][i];
+            e.charge = charges[face][i];
+            e.amplitude = amplitudes[face][i];
+            e.trigger = e.amplitude > -par.trgLevel;
+            MeasureTimesCFMPPC(GetTimes(face, i), GetSamples(face, i), par, e);
+
+            timeCFs15[face][i] = e.timeCF[0];
+            timeCFs25[face][i] = e.timeCF[1];
+            timeCFs50[face][i] = e.timeCF[2];
+            triggers[face][i] = e.trigger;
+        }
+    }
+}
+
+
+
+void EventLYSO::UpdateIntegralsForEveryMPPC(const ParametersMPPC& par)
+{
+    Double_t* charges[FACES] = {Charges_F, Charges_B};
+    Double_t* amplitudes[FACES] = {Amplitudes_F, Amplitudes_B};
+    Double_t* timeCFs15[FACES] = {TimeCFs15_F, TimeCFs15_B};
+    Double_t* timeCFs25[FACES] = {TimeCFs25_F, TimeCFs25_B};
+    Double_t* timeCFs50[FACES] = {TimeCFs50_F, TimeCFs50_B};
+    Bool_t* triggers[FACES] = {Triggers_F, Triggers_B};
+
+    // Sweep 2 on the kept baselines, then sweep 3, channel by channel
+    EstimatorsMPPC est[FACES*CHANNELS];
+    {
+        KernelScopeLYSO scope(KernelLYSO::Windows, FACES*CHANNELS);
+        for(Int_t face = 0; face < FACES; face++)
+        {
+            for(Int_t i = 0; i < CHANNELS; i++)
+            {
+                EstimatorsMPPC& e = est[face*CHANNELS + i];
+                e.baseline = fBaselines[face][i];
+                MeasureIntegralMPPC(GetTimes(face, i), GetSamples(face, i), par, e);
+            }
+        }
+    }
+
+    KernelScopeLYSO scope(KernelLYSO::TimesCF, FACES*CHANNELS);
+    for(Int_t face = 0; face < FACES; face++)
+    {
+        for(Int_t i = 0; i < CHANNELS; i++)
+        {
+            EstimatorsMPPC& e = est[face*CHANNELS + i];
+            MeasureTimesCFMPPC(GetTimes(face, i), GetSamples(face, i), par, e);
+
+            charges[face][i] = e.charge;
+            amplitudes[face][i] = e.amplitude;
+            timeCFs15[face][i] = e.timeCF[0];
+            timeCFs25[face][i] = e.timeCF[1];
+            timeCFs50[face][i] = e.timeCF[2];
+            triggers[face][i] = e.trigger;
+        }
+    }
+}
+
+
+
+void EventLYSO::AddToSum(Double_t* sumTimes, Double_t* sumSamples, const Float_t*& baseTimes, Int_t face, Int_t ch) const
+{
+    // The sum is baseline-corrected (baseline 0) and lives on the time base
+    // of its first channel, baseTimes
+    const Float_t* t = GetTimes(face, ch);
+    const Float_t* v = GetSamples(face, ch);
+    const Double_t base = fBaselines[face][ch];
+
+    if(!baseTimes)
+    {
+        copy_n(t, SAMPLINGS, sumTimes);
+        fill_n(sumSamples, SAMPLINGS, 0.);
+        baseTimes = t;
+    }
+
+    // Shared calibration grids are the same pointer, no need to compare them
+    Bool_t isSameTimeBase = true;
+    for(Int_t i = 0; i < SAMPLINGS && isSameTimeBase && t != baseTimes; i++)
+        isSameTimeBase = TMath::Abs(sumTimes[i] - t[i]) < 1e-6;
+
+    if(isSameTimeBase)
+    {
+        // Fast path: plain vector add
+        for(Int_t i = 0; i < SAMPLINGS; i++)
+            sumSamples[i] += v[i] - base;
+        return;
+    }
+
+    // Resampling of the channel on the time base of the sum (both increasing)
+    Int_t j = 0;
+    for(Int_t i = 0; i < SAMPLINGS; i++)
+    {
+        Double_t time = sumTimes[i];
+        while(j < SAMPLINGS - 2 && t[j+1] <= time)
+            j++;
+
+        Double_t sample;
+        if(time <= t[0])
+            sample = v[0];
+        else if(time >= t[SAMPLINGS-1])
+            sample = v[SAMPLINGS-1];
+        else
+            sample = WaveDRS::LinearInterpolate(t[j], v[j], t[j+1], v[j+1], time);
+
+        sumSamples[i] += sample - base;
+    }
 }
 
 
 
-WaveformMPPC EventLYSO::SumWaveforms(const char* face, RVecI channels)
+WaveformMPPC EventLYSO::SumWaveforms(const char* face, const RVecI& channels)
 {
-    RVecD tt = Range(0, SAMPLINGS);
-    RVecD vv(SAMPLINGS, 0.);
-    WaveDRS outWave(tt, vv);
+    KernelScopeLYSO scope(KernelLYSO::SumWaveforms, channels.size());
+    ArenaLYSO& arena = ArenaLYSO::GetThread();
+    Double_t* sumTimes = arena.Allocate<Double_t>(SAMPLINGS);
+    Double_t* sumSamples = arena.Allocate<Double_t>(SAMPLINGS);
+    const Float_t* baseTimes = nullptr;
 
     if(strcmp(face, "F") == 0 || strcmp(face, "f") == 0)
     {
         for(auto ch : channels)
         {
-            outWave += Front[ch].GetWave();
+            AddToSum(sumTimes, sumSamples, baseTimes, 0, ch);
         }        
     }
     else if(strcmp(face, "B") == 0 || strcmp(face, "b") == 0)
     {
         for(auto ch : channels)
         {
-            outWave += Back[ch].GetWave();
+            AddToSum(sumTimes, sumSamples, baseTimes, 1, ch);
         }
     }
     else
@@ -110,151 +342,131 @@ WaveformMPPC EventLYSO::SumWaveforms(const char* face, RVecI channels)
         return SumWaveforms("F", channels);
     }
 
-    return WaveformMPPC(outWave);
+    return WaveformMPPC(sumTimes, sumSamples, baseTimes ? SAMPLINGS : 0, 0.);
 }
 
 
 
-WaveformMPPC EventLYSO::SumWaveforms(RVecI channelsFront, RVecI channelsBack)
+WaveformMPPC EventLYSO::SumWaveforms(const RVecI& channelsFront, const RVecI& channelsBack)
 {
-    RVecD tt = Range(0, SAMPLINGS);
-    RVecD vv(SAMPLINGS, 0.);
-    WaveDRS outWave(tt, vv);
+    KernelScopeLYSO scope(KernelLYSO::SumWaveforms, channelsFront.size() + channelsBack.size());
+    ArenaLYSO& arena = ArenaLYSO::GetThread();
+    Double_t* sumTimes = arena.Allocate<Double_t>(SAMPLINGS);
+    Double_t* sumSamples = arena.Allocate<Double_t>(SAMPLINGS);
+    const Float_t* baseTimes = nullptr;
 
     for(auto ch : channelsFront)
     {
-        outWave += Front[ch].GetWave();
+        AddToSum(sumTimes, sumSamples, baseTimes, 0, ch);
     }
     for(auto ch : channelsBack)
     {
-        outWave += Back[ch].GetWave();
+        AddToSum(sumTimes, sumSamples, baseTimes, 1, ch);
     }
 
-    return WaveformMPPC(outWave);
+    return WaveformMPPC(sumTimes, sumSamples, baseTimes ? SAMPLINGS : 0, 0.);
 }
 
 
 
-Double_t EventLYSO::GetCentroidX(const char* face, Int_t nCircles)
+RVecI EventLYSO::FindFirstNeighbors(Int_t meanCh, Int_t nCircles)
 {
-    // Some useful indices
-    Int_t chAmpMaxFront = FindFrontChOfMaxAmplitude();
-    Int_t chAmpMaxBack = FindBackChOfMaxAmplitude();
-    
-    auto channelsFront = FindFirstNeighbors(chAmpMaxFront, nCircles);
-    auto channelsBack = FindFirstNeighbors(chAmpMaxBack, nCircles);
+    // Note! It returns meanCh ITSELF plus the neighbors
+    if(nCircles < 0)
+    {
+        nCircles = 0;
+        cerr << "Invalid nCircles, minimum is 0! Fixed to default value = 0" << endl;
+    }
+
+    // View on the precomputed table, no allocation
+    return GeometryLYSO::GetInstance()->GetNeighbors(meanCh, nCircles);
+}
+
+
 
+ClusterMoments EventLYSO::GetClusterMoments(const char* face, Int_t nCircles)
+{
+    // Cluster: neighbors of the channel of max amplitude, weighted by the charges
     if(strcmp(face, "F") == 0 || strcmp(face, "f") == 0)
     {
-        auto detXvec = Take(detX, channelsFront);
-        auto charges_Fvec = Take(fCharges_F, channelsFront);
-
-        return Sum(detXvec*charges_Fvec)/Sum(charges_Fvec);
+        Int_t chAmpMax = FindFrontChOfMaxAmplitude();
+        auto channels = FindFirstNeighbors(chAmpMax, nCircles);
+        return MeasureClusterMoments(Charges_F, channels.data(), channels.size(), chAmpMax);
     }
     else if(strcmp(face, "B") == 0 || strcmp(face, "b") == 0)
     {
-        auto detXvec = Take(detX, channelsBack);
-        auto charges_Bvec = Take(fCharges_B, channelsBack);
-
-        return Sum(detXvec*charges_Bvec)/Sum(charges_Bvec);
+        Int_t chAmpMax = FindBackChOfMaxAmplitude();
+        auto channels = FindFirstNeighbors(chAmpMax, nCircles);
+        return MeasureClusterMoments(Charges_B, channels.data(), channels.size(), chAmpMax);
     }
     else
     {
         cerr << "Not valid face input! Set default value: Front Face" << endl;
-        return GetCentroidX("F", nCircles);
+        return GetClusterMoments("F", nCircles);
     }
 }
 
 
 
-Double_t EventLYSO::GetCentroidY(const char* face, Int_t nCircles)
+Double_t EventLYSO::GetCentroidX(const char* face, Int_t nCircles)
 {
-    // Some useful indices
-    Int_t chAmpMaxFront = FindFrontChOfMaxAmplitude();
-    Int_t chAmpMaxBack = FindBackChOfMaxAmplitude();
-    
-    auto channelsFront = FindFirstNeighbors(chAmpMaxFront, nCircles);
-    auto channelsBack = FindFirstNeighbors(chAmpMaxBack, nCircles);
+    return GetClusterMoments(face, nCircles).GetX();
+}
 
-    if(strcmp(face, "F") == 0 || strcmp(face, "f") == 0)
-    {
-        auto detYvec = Take(detY, channelsFront);
-        auto charges_Fvec = Take(fCharges_F, channelsFront);
 
-        return Sum(detYvec*charges_Fvec)/Sum(charges_Fvec);
-    }
-    else if(strcmp(face, "B") == 0 || strcmp(face, "b") == 0)
-    {
-        auto detYvec = Take(detY, channelsBack);
-        auto charges_Bvec = Take(fCharges_B, channelsBack);
 
-        return Sum(detYvec*charges_Bvec)/Sum(charges_Bvec);
-    }
-    else
-    {
-        cerr << "Not valid face input! Set default value: Front Face" << endl;
-        return GetCentroidY("F", nCircles);
-    }
+Double_t EventLYSO::GetCentroidY(const char* face, Int_t nCircles)
+{
+    return GetClusterMoments(face, nCircles).GetY();
 }
 
 
 
 pair<Double_t, Double_t> EventLYSO::GetCentroidStdDev(const char* face, Int_t nCircles)
 {
-    Double_t X0, Y0;
-    RVecI channelsFront, channelsBack;
+    auto moments = GetClusterMoments(face, nCircles);
+    return {moments.GetSigmaX(), moments.GetSigmaY()};
+}
 
-    X0 = GetCentroidX(face, nCircles);
-    Y0 = GetCentroidY(face, nCircles);
-    Int_t chAmpMaxFront = FindFrontChOfMaxAmplitude();
-    Int_t chAmpMaxBack = FindBackChOfMaxAmplitude();
-    
-    channelsFront = FindFirstNeighbors(chAmpMaxFront, nCircles);
-    channelsBack = FindFirstNeighbors(chAmpMaxBack, nCircles);
 
-    if(strcmp(face, "F") == 0 || strcmp(face, "f") == 0)
-    {
-        auto detXvec = Take(detX, channelsFront);
-        auto detYvec = Take(detY, channelsFront);
-        auto charges_Fvec = Take(fCharges_F, channelsFront);
-
-        Double_t sigmaX = TMath::Sqrt(Sum(pow(detXvec - X0, 2)*charges_Fvec) / Sum(charges_Fvec));
-        Double_t sigmaY = TMath::Sqrt(Sum(pow(detYvec - Y0, 2)*charges_Fvec) / Sum(charges_Fvec));
-        return {sigmaX, sigmaY};
-    }
-    else if(strcmp(face, "B") == 0 || strcmp(face, "b") == 0)
-    {
-        auto detXvec = Take(detX, channelsBack);
-        auto detYvec = Take(detY, channelsBack);
-        auto charges_Bvec = Take(fCharges_B, channelsBack);
 
-        Double_t sigmaX = TMath::Sqrt(Sum(pow(detXvec - X0, 2)*charges_Bvec) / Sum(charges_Bvec));
-        Double_t sigmaY = TMath::Sqrt(Sum(pow(detYvec - Y0, 2)*charges_Bvec) / Sum(charges_Bvec));
-        return {sigmaX, sigmaY};
-    }
-    else
+void EventLYSO::MeasureDetectorCharge()
+{
+    // Charges truncated to integers and summed as such, as the RVecI sums
+    Int_t chargeF = 0, chargeB = 0;
+    for(Int_t i = 0; i < CHANNELS; i++)
     {
-        cerr << "Not valid face input! Set default value: Front Face" << endl;
-        return GetCentroidStdDev("F", nCircles);
+        chargeF += Int_t(Charges_F[i]);
+        chargeB += Int_t(Charges_B[i]);
     }
+
+    Charge_F = chargeF;
+    Charge_B = chargeB;
+    Charge_Tot = Charge_F + Charge_B;
 }
 
 
 
-void EventLYSO::MeasureDetectorCharge(RVecI channelsFront, RVecI channelsBack)
+void EventLYSO::MeasureDetectorCharge(const RVecI& channelsFront, const RVecI& channelsBack)
 {
-    RVecI chargeVec_F = Take(fCharges_F, channelsFront);
-    RVecI chargeVec_B = Take(fCharges_B, channelsBack);
-    
-    Charge_F = Sum(chargeVec_F);
-    Charge_B = Sum(chargeVec_B);
+    Int_t chargeF = 0, chargeB = 0;
+    for(auto ch : channelsFront)
+        chargeF += Int_t(Charges_F[ch]);
+    for(auto ch : channelsBack)
+        chargeB += Int_t(Charges_B[ch]);
+
+    Charge_F = chargeF;
+    Charge_B = chargeB;
     Charge_Tot = Charge_F + Charge_B;
 }
 
 
 
-void EventLYSO::MeasureDetectorTime(Int_t nCircles)
+void EventLYSO::MeasureDetectorTime(Int_t nCircles, const ParametersMPPC& par)
 {
+    // Channel lists and summed waveforms in the arena of the thread, no RVec temporaries
+    ArenaLYSO::Scope arena;
+
     // Some useful indices and waveforms
     Int_t chAmpMaxFront = FindFrontChOfMaxAmplitude();
     Int_t chAmpMaxBack = FindBackChOfMaxAmplitude();
@@ -262,87 +474,83 @@ void EventLYSO::MeasureDetectorTime(Int_t nCircles)
     auto neighborsMaxFront = FindFirstNeighbors(chAmpMaxFront, nCircles);
     auto neighborsMaxBack = FindFirstNeighbors(chAmpMaxBack, nCircles);
     
-    RVecI trgIndices_F = Nonzero(fTrigger_F);
-    RVecI trgIndices_B = Nonzero(fTrigger_B);
+    RVecI trgIndices_F = SelectTriggered(Triggers_F, nullptr, CHANNELS, arena.Allocate<Int_t>(CHANNELS));
+    RVecI trgIndices_B = SelectTriggered(Triggers_B, nullptr, CHANNELS, arena.Allocate<Int_t>(CHANNELS));
 
-    auto intersection_F = Intersect(neighborsMaxFront, trgIndices_F);
-    auto intersection_B = Intersect(neighborsMaxBack, trgIndices_B);
+    RVecI intersection_F = SelectTriggered(Triggers_F, neighborsMaxFront.data(), neighborsMaxFront.size(), arena.Allocate<Int_t>(CHANNELS));
+    RVecI intersection_B = SelectTriggered(Triggers_B, neighborsMaxBack.data(), neighborsMaxBack.size(), arena.Allocate<Int_t>(CHANNELS));
 
     WaveformMPPC sumWaveFront = SumWaveforms("F", neighborsMaxFront);
     WaveformMPPC sumWaveBack = SumWaveforms("B", neighborsMaxBack);
+    sumWaveFront.MeasureTimesCF<DefaultFractionsMPPC>(par);
+    sumWaveBack.MeasureTimesCF<DefaultFractionsMPPC>(par);
     
 
     // Single waves: First -> Entry 0
-    Time15_F[0] = Min(Take(fTimeCFs15_F, trgIndices_F));
-    Time15_B[0] = Min(Take(fTimeCFs15_B, trgIndices_B));
+    Time15_F[0] = MinOf(TimeCFs15_F, trgIndices_F);
+    Time15_B[0] = MinOf(TimeCFs15_B, trgIndices_B);
 
     // Single waves: Higher -> Entry 1
     Time15_F[1] = fTimeCFs15_F[chAmpMaxFront];
     Time15_B[1] = fTimeCFs15_B[chAmpMaxBack];
     
     // Single waves around higher: Average -> Entry 2
-    Time15_F[2] = Mean(Take(fTimeCFs15_F, intersection_F));
-    Time15_B[2] = Mean(Take(fTimeCFs15_B, intersection_B));
+    Time15_F[2] = MeanOf(TimeCFs15_F, intersection_F);
+    Time15_B[2] = MeanOf(TimeCFs15_B, intersection_B);
 
     // Single waves around higher: Weighted average -> Entry 3
-    Double_t wmFront15 = Sum(Take(fTimeCFs15_F*fAmplitudes_F, intersection_F)) / Sum(Take(fAmplitudes_F, intersection_F));
-    Double_t wmBack15 = Sum(Take(fTimeCFs15_B*fAmplitudes_B, intersection_B)) / Sum(Take(fAmplitudes_B, intersection_B));
+    Double_t wmFront15 = WeightedMeanOf(TimeCFs15_F, Amplitudes_F, intersection_F);
+    Double_t wmBack15 = WeightedMeanOf(TimeCFs15_B, Amplitudes_B, intersection_B);
     Time15_F[3] = wmFront15;
     Time15_B[3] = wmBack15;
 
     // Sum of waves around higher -> Entry 4
-    sumWaveFront.MeasureTimeCF(0.15, 15);
-    sumWaveBack.MeasureTimeCF(0.15, 15);
     Time15_F[4] = sumWaveFront.GetTimeCF15();
     Time15_B[4] = sumWaveBack.GetTimeCF15();
 
 
     // Single waves: First -> Entry 0
-    Time25_F[0] = Min(Take(fTimeCFs25_F, trgIndices_F));
-    Time25_B[0] = Min(Take(fTimeCFs25_B, trgIndices_B));
+    Time25_F[0] = MinOf(TimeCFs25_F, trgIndices_F);
+    Time25_B[0] = MinOf(TimeCFs25_B, trgIndices_B);
 
     // Single waves: Higher -> Entry 1
     Time25_F[1] = fTimeCFs25_F[chAmpMaxFront];
     Time25_B[1] = fTimeCFs25_B[chAmpMaxBack];
     
     // Single waves around higher: Average -> Entry 2
-    Time25_F[2] = Mean(Take(fTimeCFs25_F, intersection_F));
-    Time25_B[2] = Mean(Take(fTimeCFs25_B, intersection_B));
+    Time25_F[2] = MeanOf(TimeCFs25_F, intersection_F);
+    Time25_B[2] = MeanOf(TimeCFs25_B, intersection_B);
 
     // Single waves around higher: Weighted average -> Entry 3
-    Double_t wmFront25 = Sum(Take(fTimeCFs25_F*fAmplitudes_F, intersection_F)) / Sum(Take(fAmplitudes_F, intersection_F));
-    Double_t wmBack25 = Sum(Take(fTimeCFs25_B*fAmplitudes_B, intersection_B)) / Sum(Take(fAmplitudes_B, intersection_B));
+    Double_t wmFront25 = WeightedMeanOf(TimeCFs25_F, Amplitudes_F, intersection_F);
+    Double_t wmBack25 = WeightedMeanOf(TimeCFs25_B, Amplitudes_B, intersection_B);
     Time25_F[3] = wmFront25;
     Time25_B[3] = wmBack25;
 
     // Sum of waves around higher -> Entry 4
-    sumWaveFront.MeasureTimeCF(0.25, 25);
-    sumWaveBack.MeasureTimeCF(0.25, 25);
     Time25_F[4] = sumWaveFront.GetTimeCF25();
     Time25_B[4] = sumWaveBack.GetTimeCF25();
 
 
     // Single waves: First -> Entry 0
-    Time50_F[0] = Min(Take(fTimeCFs50_F, trgIndices_F));
-    Time50_B[0] = Min(Take(fTimeCFs50_B, trgIndices_B));
+    Time50_F[0] = MinOf(TimeCFs50_F, trgIndices_F);
+    Time50_B[0] = MinOf(TimeCFs50_B, trgIndices_B);
 
     // Single waves: Higher -> Entry 1
     Time50_F[1] = fTimeCFs50_F[chAmpMaxFront];
     Time50_B[1] = fTimeCFs50_B[chAmpMaxBack];
     
     // Single waves around higher: Average -> Entry 2
-    Time50_F[2] = Mean(Take(fTimeCFs50_F, intersection_F));
-    Time50_B[2] = Mean(Take(fTimeCFs50_B, intersection_B));
+    Time50_F[2] = MeanOf(TimeCFs50_F, intersection_F);
+    Time50_B[2] = MeanOf(TimeCFs50_B, intersection_B);
 
     // Single waves around higher: Weighted average -> Entry 3
-    Double_t wmFront50 = Sum(Take(fTimeCFs50_F*fAmplitudes_F, intersection_F)) / Sum(Take(fAmplitudes_F, intersection_F));
-    Double_t wmBack50 = Sum(Take(fTimeCFs50_B*fAmplitudes_B, intersection_B)) / Sum(Take(fAmplitudes_B, intersection_B));
+    Double_t wmFront50 = WeightedMeanOf(TimeCFs50_F, Amplitudes_F, intersection_F);
+    Double_t wmBack50 = WeightedMeanOf(TimeCFs50_B, Amplitudes_B, intersection_B);
     Time50_F[3] = wmFront50;
     Time50_B[3] = wmBack50;
 
     // Sum of waves around higher -> Entry 4
-    sumWaveFront.MeasureTimeCF(0.50, 50);
-    sumWaveBack.MeasureTimeCF(0.50, 50);
     Time50_F[4] = sumWaveFront.GetTimeCF50();
     Time50_B[4] = sumWaveBack.GetTimeCF50();
 }
@@ -351,21 +559,22 @@ void EventLYSO::MeasureDetectorTime(Int_t nCircles)
 
 void EventLYSO::MeasureDetectorPosition(Int_t nCircles)
 {
+    // One pass per face for centroid and sigma
+    auto momentsF = GetClusterMoments("F", nCircles);
+    auto momentsB = GetClusterMoments("B", nCircles);
+
     // xCentroid
-    Centroid_F[0] = GetCentroidX("F", nCircles);
-    Centroid_B[0] = GetCentroidX("B", nCircles);
+    Centroid_F[0] = momentsF.GetX();
+    Centroid_B[0] = momentsB.GetX();
 
     // y Centroid
-    Centroid_F[1] = GetCentroidY("F", nCircles);
-    Centroid_B[1] = GetCentroidY("B", nCircles);
+    Centroid_F[1] = momentsF.GetY();
+    Centroid_B[1] = momentsB.GetY();
 
     // sigma Centroid
-    auto stdF = GetCentroidStdDev("F", nCircles);
-    auto stdB = GetCentroidStdDev("B", nCircles);
+    Centroid_F[2] = momentsF.GetSigmaX();
+    Centroid_B[2] = momentsB.GetSigmaX();
     
-    Centroid_F[2] = stdF.first;
-    Centroid_B[2] = stdB.first;
-    
-    Centroid_F[3] = stdF.second;
-    Centroid_B[3] = stdB.second;
-}
\ No newline at end of file
+    Centroid_F[3] = momentsF.GetSigmaY();
+    Centroid_B[3] = momentsB.GetSigmaY();
+}
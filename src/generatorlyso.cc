@@ -0,0 +1,349 @@
+#include "generatorlyso.hh"
+#include "shardlyso.hh"
+
+#include <random>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <sstream>
+
+#include <TFile.h>
+#include <TTree.h>
+#include <TROOT.h>
+#include <TSystem.h>
+#include <TMath.h>
+
+using namespace std;
+using namespace ROOT;
+
+
+Bool_t GeneratorParameters::Set(const string& name, const string& value)
+{
+    try
+    {
+        if(name == "events")
+            nEvents = stoll(value);
+        else if(name == "seed")
+            seed = stoul(value);
+        else if(name == "compression")
+            compression = stoi(value);
+        else if(name == "sampling")
+            samplingPeriod = stod(value);
+        else if(name == "cell-jitter")
+            cellJitter = stod(value);
+        else if(name == "stop-cells")
+            stopCells = stoi(value) != 0;
+        else if(name == "rise")
+            riseTime = stod(value);
+        else if(name == "decay")
+            decayTime = stod(value);
+        else if(name == "pulse-time")
+            pulseTime = stod(value);
+        else if(name == "time-jitter")
+            timeJitter = stod(value);
+        else if(name == "amplitude")
+            amplitude = stod(value);
+        else if(name == "amplitude-spread")
+            amplitudeSpread = stod(value);
+        else if(name == "light-spread")
+            lightSpread = stod(value);
+        else if(name == "back-ratio")
+            backRatio = stod(value);
+        else if(name == "noise")
+            noise = stod(value);
+        else if(name == "baseline")
+            baseline = stod(value);
+        else if(name == "pile-up")
+            pileUp = stod(value);
+        else if(name == "hit")
+        {
+            // "uniform" or "x,y[,sigma]"
+            if(value == "uniform")
+            {
+                uniformHit = true;
+                return true;
+            }
+            vector<Double_t> xys;
+            istringstream list(value);
+            string item;
+            while(getline(list, item, ','))
+                xys.push_back(stod(item));
+            if(xys.size() < 2 || xys.size() > 3)
+                return false;
+            uniformHit = false;
+            hitX = xys[0];
+            hitY = xys[1];
+            hitSigma = xys.size() == 3 ? xys[2] : 0.;
+        }
+        else
+            return false;
+    }
+    catch(const exception&)
+    {
+        return false;
+    }
+
+    return nEvents >= 0 && samplingPeriod > 0 && riseTime > 0 && decayTime > 0 && lightSpread > 0 && pileUp >= 0;
+}
+
+
+
+string GeneratorParameters::ToString() const
+{
+    ostringstream text;
+    text << "events = " << nEvents << endl;
+    text << "seed = " << seed << endl;
+    text << "sampling = " << samplingPeriod << endl;
+    text << "cell-jitter = " << cellJitter << endl;
+    text << "stop-cells = " << stopCells << endl;
+    text << "rise = " << riseTime << endl;
+    text << "decay = " << decayTime << endl;
+    text << "pulse-time = " << pulseTime << endl;
+    text << "time-jitter = " << timeJitter << endl;
+    text << "amplitude = " << amplitude << endl;
+    text << "amplitude-spread = " << amplitudeSpread << endl;
+    text << "light-spread = " << lightSpread << endl;
+    text << "back-ratio = " << backRatio << endl;
+    if(uniformHit)
+        text << "hit = uniform" << endl;
+    else
+        text << "hit = " << hitX << "," << hitY << "," << hitSigma << endl;
+    text << "noise = " << noise << endl;
+    text << "baseline = " << baseline << endl;
+    text << "pile-up = " << pileUp << endl;
+
+    return text.str();
+}
+
+
+
+GeneratedEventLYSO::GeneratedEventLYSO()
+    : volts_F(CHANNELS, RVecF(SAMPLINGS)), volts_B(CHANNELS, RVecF(SAMPLINGS)),
+      stopCell_F(CHANNELS, 0), stopCell_B(CHANNELS, 0)
+{}
+
+
+
+GeneratorLYSO::GeneratorLYSO(const GeneratorParameters& par)
+    : fPar(par), fTimes_F(CHANNELS, RVecF(SAMPLINGS)), fTimes_B(CHANNELS, RVecF(SAMPLINGS))
+{
+    // Stop cell 0 grids: cells of samplingPeriod, jittered per channel
+    mt19937_64 rng(fPar.seed);
+    normal_distribution<Double_t> gaus(0., 1.);
+    vector<RVecF>* times[FACES] = {&fTimes_F, &fTimes_B};
+    for(Int_t face = 0; face < FACES; face++)
+    {
+        for(Int_t ch = 0; ch < CHANNELS; ch++)
+        {
+            RVecF& t = (*times[face])[ch];
+            Double_t time = 0.;
+            for(Int_t i = 0; i < SAMPLINGS; i++)
+            {
+                t[i] = time;
+                Double_t width = fPar.samplingPeriod*(1 + fPar.cellJitter*gaus(rng));
+                time += max(width, 0.1*fPar.samplingPeriod);
+            }
+        }
+    }
+    fCalibration = make_shared<TimeCalibrationLYSO>(fTimes_F, fTimes_B);
+
+    Double_t tPeak = fPar.riseTime*TMath::Log(1 + fPar.decayTime/fPar.riseTime);
+    fPeak = (1 - TMath::Exp(-tPeak/fPar.riseTime))*TMath::Exp(-tPeak/fPar.decayTime);
+}
+
+
+
+void GeneratorLYSO::Generate(Long64_t k, GeneratedEventLYSO& event) const
+{
+    struct Pulse
+    {
+        Double_t x, y, t0, amplitude;
+    };
+
+    seed_seq seq{UInt_t(fPar.seed), UInt_t(k), UInt_t(k >> 32)};
+    mt19937_64 rng(seq);
+    normal_distribution<Double_t> gaus(0., 1.);
+    uniform_real_distribution<Double_t> uniform(0., 1.);
+
+    const Double_t xMin = TMath::MinElement(CHANNELS, detX), xMax = TMath::MaxElement(CHANNELS, detX);
+    const Double_t yMin = TMath::MinElement(CHANNELS, detY), yMax = TMath::MaxElement(CHANNELS, detY);
+    const Double_t window = SAMPLINGS*fPar.samplingPeriod;
+
+    vector<Pulse> pulses;
+    Pulse hit;
+    if(fPar.uniformHit)
+    {
+        hit.x = xMin + (xMax - xMin)*uniform(rng);
+        hit.y = yMin + (yMax - yMin)*uniform(rng);
+    }
+    else
+    {
+        hit.x = fPar.hitX + fPar.hitSigma*gaus(rng);
+        hit.y = fPar.hitY + fPar.hitSigma*gaus(rng);
+    }
+    hit.t0 = fPar.pulseTime + fPar.timeJitter*gaus(rng);
+    hit.amplitude = fPar.amplitude*max(1 + fPar.amplitudeSpread*gaus(rng), 0.);
+    pulses.push_back(hit);
+
+    // Pile-up, also from before the window (tails)
+    Int_t nPileUp = fPar.pileUp > 0 ? poisson_distribution<Int_t>(fPar.pileUp)(rng) : 0;
+    for(Int_t p = 0; p < nPileUp; p++)
+    {
+        Pulse pulse;
+        pulse.x = xMin + (xMax - xMin)*uniform(rng);
+        pulse.y = yMin + (yMax - yMin)*uniform(rng);
+        pulse.t0 = -3*fPar.decayTime + (window + 3*fPar.decayTime)*uniform(rng);
+        pulse.amplitude = fPar.amplitude*uniform(rng);
+        pulses.push_back(pulse);
+    }
+
+    event.evt = k;
+    vector<RVecF>* volts[FACES] = {&event.volts_F, &event.volts_B};
+    vector<Int_t>* stopCells[FACES] = {&event.stopCell_F, &event.stopCell_B};
+    for(Int_t face = 0; face < FACES; face++)
+    {
+        // The channels of a face share the DRS stop cell
+        Int_t stopCell = fPar.stopCells ? min<Int_t>(uniform(rng)*SAMPLINGS, SAMPLINGS - 1) : 0;
+        fill(stopCells[face]->begin(), stopCells[face]->end(), stopCell);
+        Double_t ratio = face == 0 ? 1. : fPar.backRatio;
+
+        for(Int_t ch = 0; ch < CHANNELS; ch++)
+        {
+            const Float_t* t = fCalibration->GetTimes(face, ch, stopCell);
+            Float_t* v = (*volts[face])[ch].data();
+            for(Int_t i = 0; i < SAMPLINGS; i++)
+                v[i] = fPar.baseline + fPar.noise*gaus(rng);
+
+            for(const auto& p : pulses)
+            {
+                Double_t d2 = (detX[ch] - p.x)*(detX[ch] - p.x) + (detY[ch] - p.y)*(detY[ch] - p.y);
+                Double_t a = ratio*p.amplitude*TMath::Exp(-d2/(2*fPar.lightSpread*fPar.lightSpread))/fPeak;
+                // Below a microvolt: nothing to add over the noise
+                if(a < 1e-6)
+                    continue;
+
+                for(Int_t i = 0; i < SAMPLINGS; i++)
+                {
+                    Double_t dt = t[i] - p.t0;
+                    if(dt > 0)
+                        v[i] -= a*(1 - TMath::Exp(-dt/fPar.riseTime))*TMath::Exp(-dt/fPar.decayTime);
+                }
+            }
+        }
+    }
+}
+
+
+
+Bool_t GeneratorLYSO::Write(const string& filename, Int_t nThreads) const
+{
+    nThreads = max<Int_t>(min<Long64_t>(nThreads, fPar.nEvents), 1);
+    if(nThreads == 1)
+        return WriteBlock(filename, 0, fPar.nEvents, true);
+
+    // Every thread a contiguous block into its part file, then the parts
+    // in block order
+    ROOT::EnableThreadSafety();
+    vector<string> partFilenames(nThreads);
+    vector<thread> workers;
+    atomic<Bool_t> ok{true};
+    for(Int_t t = 0; t < nThreads; t++)
+    {
+        Long64_t first = fPar.nEvents * t / nThreads;
+        Long64_t last = fPar.nEvents * (t + 1) / nThreads;
+        partFilenames[t] = ShardFilename(filename, "part" + to_string(t));
+
+        workers.emplace_back([this, first, last, &ok, &partFilename = partFilenames[t]]()
+        {
+            if(!WriteBlock(partFilename, first, last, false))
+                ok = false;
+        });
+    }
+    for(auto& w : workers)
+        w.join();
+
+    // Fast merging: baskets are copied, the waveforms are not recompressed
+    Bool_t merged = ok && ConcatenateOutputs(filename, partFilenames, {"lyso_wfs"});
+    for(const auto& part : partFilenames)
+        gSystem->Unlink(part.c_str());
+    if(!merged)
+        return false;
+
+    unique_ptr<TFile> file(TFile::Open(filename.c_str(), "UPDATE"));
+    if(!file || file->IsZombie())
+    {
+        cerr << "Error opening file: " << filename << endl;
+        return false;
+    }
+    WriteTimes(file.get());
+    file->Close();
+
+    return true;
+}
+
+
+
+Bool_t GeneratorLYSO::WriteBlock(const string& filename, Long64_t first, Long64_t last, Bool_t withTimes) const
+{
+    unique_ptr<TFile> file(TFile::Open(filename.c_str(), "RECREATE"));
+    if(!file || file->IsZombie())
+    {
+        cerr << "Error opening file: " << filename << endl;
+        return false;
+    }
+    if(fPar.compression >= 0)
+        file->SetCompressionSettings(fPar.compression);
+
+    if(withTimes)
+        WriteTimes(file.get());
+
+    // Gone before the file is closed
+    {
+        GeneratedEventLYSO event;
+        Int_t evt;
+        auto* front = &event.volts_F;
+        auto* back = &event.volts_B;
+        auto* stopCell_F = &event.stopCell_F;
+        auto* stopCell_B = &event.stopCell_B;
+
+        file->cd();
+        auto lyso_wfs = make_unique<TTree>("lyso_wfs", "TTree of lyso waveforms");
+        lyso_wfs->Branch("Event", &evt, "Event/I");
+        lyso_wfs->Branch("Front", &front);
+        lyso_wfs->Branch("Back", &back);
+        if(fPar.stopCells)
+        {
+            lyso_wfs->Branch("StopCell_F", &stopCell_F);
+            lyso_wfs->Branch("StopCell_B", &stopCell_B);
+        }
+
+        for(Long64_t k = first; k < last; k++)
+        {
+            Generate(k, event);
+            evt = event.evt;
+            lyso_wfs->Fill();
+        }
+        file->WriteObject(lyso_wfs.get(), "lyso_wfs");
+    }
+
+    file->Close();
+    return true;
+}
+
+
+
+Bool_t GeneratorLYSO::WriteTimes(TFile* file) const
+{
+    // Only read by Fill
+    auto* times_F = const_cast<vector<RVecF>*>(&fTimes_F);
+    auto* times_B = const_cast<vector<RVecF>*>(&fTimes_B);
+
+    file->cd();
+    auto lyso_wfs_times = make_unique<TTree>("lyso_wfs_times", "TTree of lyso time calibration");
+    lyso_wfs_times->Branch("Time_F", &times_F);
+    lyso_wfs_times->Branch("Time_B", &times_B);
+    lyso_wfs_times->Fill();
+    file->WriteObject(lyso_wfs_times.get(), "lyso_wfs_times");
+
+    return true;
+}
@@ -0,0 +1,106 @@
+#include "geometrylyso.hh"
+
+using namespace std;
+
+
+namespace
+{
+    // Same selection as the original EventLYSO::FindFirstNeighbors, evaluated
+    // by the compiler with the same double operations
+    constexpr Double_t epsilon = 0.01;
+
+    constexpr Double_t Abs(Double_t x)
+    {
+        return x < 0 ? -x : x;
+    }
+
+    constexpr Bool_t IsNeighbor(Int_t i, Int_t ch, Int_t nCircles)
+    {
+        Double_t xMax = nCircles*xSideDet + epsilon;
+        Double_t yMax = nCircles*ySideDet + epsilon;
+        return Abs(detX[i] - detX[ch]) < xMax && Abs(detY[i] - detY[ch]) < yMax;
+    }
+
+    constexpr Int_t CountNeighbors()
+    {
+        Int_t count = 0;
+        for(Int_t nCircles = 0; nCircles <= MAX_CIRCLES; nCircles++)
+            for(Int_t ch = 0; ch < CHANNELS; ch++)
+                for(Int_t i = 0; i < CHANNELS; i++)
+                    count += IsNeighbor(i, ch, nCircles);
+        return count;
+    }
+
+    struct NeighborTables
+    {
+        Int_t offsets[MAX_CIRCLES + 1][CHANNELS + 1] = {};
+        Int_t channels[CountNeighbors()] = {};
+    };
+
+    constexpr NeighborTables BuildNeighborTables()
+    {
+        NeighborTables tables{};
+        Int_t size = 0;
+        for(Int_t nCircles = 0; nCircles <= MAX_CIRCLES; nCircles++)
+        {
+            for(Int_t ch = 0; ch < CHANNELS; ch++)
+            {
+                tables.offsets[nCircles][ch] = size;
+                for(Int_t i = 0; i < CHANNELS; i++)
+                {
+                    if(IsNeighbor(i, ch, nCircles))
+                        tables.channels[size++] = i;
+                }
+            }
+            tables.offsets[nCircles][CHANNELS] = size;
+        }
+        return tables;
+    }
+
+    // In the read-only data of the executable: nothing is built at run time
+    constexpr NeighborTables neighborTables = BuildNeighborTables();
+
+    constexpr Bool_t CoversDetector(Int_t nCircles)
+    {
+        for(Int_t ch = 0; ch < CHANNELS; ch++)
+        {
+            if(neighborTables.offsets[nCircles][ch+1] - neighborTables.offsets[nCircles][ch] != CHANNELS)
+                return false;
+        }
+        return true;
+    }
+
+    static_assert(CoversDetector(MAX_CIRCLES), "MAX_CIRCLES circles must cover the whole detector");
+}
+
+
+
+GeometryLYSO::GeometryLYSO()
+    : fChannels(neighborTables.channels), fOffsets(neighborTables.offsets)
+{
+}
+
+
+
+ClusterMoments MeasureClusterMoments(const Double_t* weights, const Int_t* channels, Int_t nChannels, Int_t originCh)
+{
+    ClusterMoments m;
+    m.x0 = detX[originCh];
+    m.y0 = detY[originCh];
+
+    for(Int_t k = 0; k < nChannels; k++)
+    {
+        Int_t ch = channels[k];
+        Double_t w = weights[ch];
+        Double_t dx = detX[ch] - m.x0;
+        Double_t dy = detY[ch] - m.y0;
+
+        m.sumW += w;
+        m.sumWX += detX[ch]*w;
+        m.sumWY += detY[ch]*w;
+        m.sumWX2 += dx*dx*w;
+        m.sumWY2 += dy*dy*w;
+    }
+
+    return m;
+}
@@ -1,39 +0,0 @@
-#include "globals.hh"
-
-using namespace ROOT;
-
-const RVecD detX =
-{
-    -7.6, -0.25, 7.1, 
-    -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 
-    -29.65, -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 29.15, 
-    -37, -29.65, -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 29.15, 36.5,
-    -37, -29.65, -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 29.15, 36.5,
-    -37, -29.65, -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 29.15, 36.5,
-    -37, -29.65, -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 29.15, 36.5,
-    -37, -29.65, -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 29.15, 36.5,
-    -37, -29.65, -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 29.15, 36.5,
-    -37, -29.65, -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 29.15, 36.5,
-    -29.65, -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 29.15, 
-    -22.3, -14.95, -7.6, -0.25, 7.1, 14.45, 21.8, 
-    -7.6, -0.25, 7.1
-}; //!
-
-
-
-const RVecD detY = 
-{
-    41.1, 41.1, 41.1, 
-    34.25, 34.25, 34.25, 34.25, 34.25, 34.25, 34.25, 
-    27.4, 27.4, 27.4, 27.4, 27.4, 27.4, 27.4, 27.4, 27.4, 
-    20.55, 20.55, 20.55, 20.55, 20.55, 20.55, 20.55, 20.55, 20.55, 20.55, 20.55, 
-    13.7, 13.7, 13.7, 13.7, 13.7, 13.7, 13.7, 13.7, 13.7, 13.7, 13.7,
-    6.85, 6.85, 6.85, 6.85, 6.85, 6.85, 6.85, 6.85, 6.85, 6.85, 6.85,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    -6.85, -6.85, -6.85, -6.85, -6.85, -6.85, -6.85, -6.85, -6.85, -6.85, -6.85,
-    -13.7, -13.7, -13.7, -13.7, -13.7, -13.7, -13.7, -13.7, -13.7, -13.7, -13.7,
-    -20.55, -20.55, -20.55, -20.55, -20.55, -20.55, -20.55, -20.55, -20.55, -20.55, -20.55,
-    -27.4, -27.4, -27.4, -27.4, -27.4, -27.4, -27.4, -27.4, -27.4,
-    -34.25, -34.25, -34.25, -34.25, -34.25, -34.25, -34.25,
-    -41.1, -41.1, -41.1
-}; //!
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "hwcounterslyso.hh"
+
+#include <cstring>
+#include <cerrno>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+using namespace std;
+
+
+namespace
+{
+    const char* hwEventNames[HwCountersLYSO::N] = {"cycles", "instructions", "cache_misses", "branch_misses", "page_faults"};
+
+#ifdef __linux__
+    // (type, config) of every HwEventLYSO
+    const pair<UInt_t, ULong64_t> hwEventCodes[HwCountersLYSO::N] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS}};
+
+    Int_t OpenEvent(Int_t e, Int_t groupFd)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = hwEventCodes[e].first;
+        attr.config = hwEventCodes[e].second;
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.disabled = groupFd < 0;
+        // User space only: allowed with perf_event_paranoid <= 2
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        // This thread, any CPU
+        return syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+    }
+#endif
+}
+
+
+
+const char* GetHwEventName(HwEventLYSO event)
+{
+    return hwEventNames[(Int_t)event];
+}
+
+
+
+HwCountersLYSO::HwCountersLYSO()
+{
+    for(Int_t e = 0; e < N; e++)
+    {
+        fFds[e] = -1;
+        fIndex[e] = -1;
+    }
+
+#ifdef __linux__
+    // Leader: the first event that opens. Without a PMU (VMs, some
+    // containers) only the software events are left
+    string missing;
+    Int_t firstError = 0;
+    for(Int_t e = 0; e < N; e++)
+    {
+        fFds[e] = OpenEvent(e, fLeader);
+        if(fFds[e] < 0)
+        {
+            if(!firstError)
+                firstError = errno;
+            missing += string(missing.empty() ? "" : ", ") + hwEventNames[e];
+            continue;
+        }
+        if(fLeader < 0)
+            fLeader = fFds[e];
+        fIndex[e] = fOpened++;
+    }
+
+    if(fLeader < 0)
+    {
+        fStatus = string("perf_event_open not available (") + strerror(firstError) + "), see /proc/sys/kernel/perf_event_paranoid and the seccomp profile of the container";
+        return;
+    }
+
+    ioctl(fLeader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fLeader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    if(missing.empty())
+        fStatus = "all the counters";
+    else
+        fStatus = "not available: " + missing + " (" + strerror(firstError) + ")";
+#else
+    fStatus = "perf_event_open needs Linux";
+#endif
+}
+
+
+
+HwCountersLYSO::~HwCountersLYSO()
+{
+#ifdef __linux__
+    for(Int_t e = 0; e < N; e++)
+    {
+        if(fFds[e] >= 0)
+            close(fFds[e]);
+    }
+#endif
+}
+
+
+
+void HwCountersLYSO::Read(ULong64_t values[N]) const
+{
+    // Group read format: nr, then the values in opening order
+    ULong64_t buffer[1 + N] = {};
+#ifdef __linux__
+    if(fLeader >= 0 && read(fLeader, buffer, sizeof(ULong64_t)*(1 + fOpened)) < 0)
+        buffer[0] = 0;
+#endif
+
+    for(Int_t e = 0; e < N; e++)
+        values[e] = fIndex[e] >= 0 && fIndex[e] < (Int_t)buffer[0] ? buffer[1 + fIndex[e]] : 0;
+}
@@ -0,0 +1,111 @@
+#include "inputlyso.hh"
+
+using namespace std;
+using namespace ROOT;
+
+
+InputLYSO::InputLYSO(const char* barFilename, shared_ptr<TimeCalibrationLYSO> calibration)
+    : fCalibration(move(calibration))
+{
+    barFile.reset(TFile::Open(barFilename, "READ"));
+    if(!barFile || barFile->IsZombie())
+    {
+        cerr << "Error opening file: " << barFilename << endl;
+        return;
+    }
+
+    lyso_wfs_times = barFile->Get<TTree>("lyso_wfs_times");
+    lyso_wfs = barFile->Get<TTree>("lyso_wfs");
+    if(!IsValid())
+    {
+        cerr << "Trees lyso_wfs/lyso_wfs_times not found in: " << barFilename << endl;
+        return;
+    }
+
+    lyso_wfs->SetBranchAddress("Event", &fEvent);
+    lyso_wfs_times->SetBranchAddress("Time_F", &fTime_F);
+    lyso_wfs_times->SetBranchAddress("Time_B", &fTime_B);
+    lyso_wfs->SetBranchAddress("Front", &fFront);
+    lyso_wfs->SetBranchAddress("Back", &fBack);
+    if(lyso_wfs->GetBranch("StopCell_F") && lyso_wfs->GetBranch("StopCell_B"))
+    {
+        lyso_wfs->SetBranchAddress("StopCell_F", &fStopCell_F);
+        lyso_wfs->SetBranchAddress("StopCell_B", &fStopCell_B);
+    }
+
+    // Entry 0 of the times is the stop cell 0 calibration, the grids of the
+    // other stop cells are derived from it
+    lyso_wfs_times->GetEntry(0);
+    if(!fCalibration)
+        fCalibration = make_shared<TimeCalibrationLYSO>(*fTime_F, *fTime_B);
+
+    for(Int_t face = 0; face < FACES; face++)
+    {
+        for(Int_t ch = 0; ch < CHANNELS; ch++)
+            fTimeGrids[face*CHANNELS + ch] = fCalibration->GetTimes(face, ch);
+    }
+
+    nEntries = lyso_wfs->GetEntries();
+}
+
+
+
+InputLYSO::~InputLYSO()
+{
+    delete lyso_wfs_times;
+    delete lyso_wfs;
+    delete fTime_F;
+    delete fTime_B;
+    delete fFront;
+    delete fBack;
+    delete fStopCell_F;
+    delete fStopCell_B;
+}
+
+
+
+void InputLYSO::GetEntry(Long64_t k)
+{
+    lyso_wfs->GetEntry(k);
+
+    if(!HasStopCells())
+        return;
+
+    const vector<Int_t>* stopCells[FACES] = {fStopCell_F, fStopCell_B};
+    for(Int_t face = 0; face < FACES; face++)
+    {
+        for(Int_t ch = 0; ch < CHANNELS; ch++)
+        {
+            Int_t cell = ch < (Int_t)stopCells[face]->size() ? (*stopCells[face])[ch] : 0;
+            if(cell < 0 || cell >= SAMPLINGS)
+                cell = 0;
+            fTimeGrids[face*CHANNELS + ch] = fCalibration->GetTimes(face, ch, cell);
+        }
+    }
+}
+
+
+
+void InputLYSO::SetCache(Long64_t first, Long64_t last, Long64_t cacheSize, Bool_t isPrefetching)
+{
+    lyso_wfs->SetClusterPrefetch(isPrefetching);
+    lyso_wfs->SetCacheSize(cacheSize);
+    lyso_wfs->AddBranchToCache("*", true);
+    lyso_wfs->SetCacheEntryRange(first, last);
+    // Every branch is read: no need to learn which ones
+    lyso_wfs->StopCacheLearningPhase();
+}
+
+
+
+vector<pair<Long64_t, Long64_t>> InputLYSO::GetClusters(Long64_t first, Long64_t last) const
+{
+    vector<pair<Long64_t, Long64_t>> clusters;
+
+    auto it = lyso_wfs->GetClusterIterator(first);
+    Long64_t start;
+    while((start = it()) < last)
+        clusters.emplace_back(TMath::Max(start, first), TMath::Min(it.GetNextEntry(), last));
+
+    return clusters;
+}
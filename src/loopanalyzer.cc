@@ -0,0 +1,584 @@
+#include "loopanalyzer.hh"
+#include "simdmppc.hh"
+#include "checkpointlyso.hh"
+#include "channelcachelyso.hh"
+
+#include <TROOT.h>
+#include <TSystem.h>
+#include <TFileMerger.h>
+
+using namespace std;
+using namespace ROOT;
+
+
+LoopAnalyzer::LoopAnalyzer(const char* barFile, const char* outputFile)
+    : barFilename(barFile), outputFilename(outputFile)
+{
+}
+
+
+
+Bool_t LoopAnalyzer::Run()
+{
+    if(!cacheInputFilename.empty())
+        return RunGlobalStage();
+    if(!cacheOutputFilename.empty() && checkpointEntries > 0)
+    {
+        cerr << "The channel cache can't be written by a checkpointed run" << endl;
+        return false;
+    }
+    if(!scan.IsEmpty() && (checkpointEntries > 0 || !cacheOutputFilename.empty()))
+    {
+        cerr << "Scans can't be checkpointed or write the channel cache" << endl;
+        return false;
+    }
+
+    Long64_t totalEntries;
+    {
+        InputLYSO input(barFilename.c_str());
+        if(!input.IsValid())
+            return false;
+        totalEntries = input.GetEntries();
+        inputUUID = input.GetUUID();
+        // Time grids are shared by all threads
+        calibration = input.GetCalibration();
+    }
+
+    Bool_t isShard = SetEntries(totalEntries);
+
+    if(isVerbose)
+    {
+        cout << "AnalyzerWT>> Entries = " << nEntries;
+        if(isShard)
+            cout << " [" << firstEntry << ", " << lastEntry << ") of " << totalEntries;
+        cout << endl;
+        cout << "AnalyzerWT>> SIMD kernels: " << GetSimdLevelName(GetSimdLevel()) << endl;
+        cout << "AnalyzerWT>> Output: " << GetOutputFormatName(outputFormat) << ", " << GetOutputTierName(outputTier) << " tier" << endl;
+    }
+
+    nProcessed = 0;
+    startTime = chrono::steady_clock::now();
+    readAheadStats = ReadAheadStats();
+    Int_t nUsefulThreads = nEntries < nThreads ? 1 : nThreads;
+
+    // I/O threads read ROOT files too
+    if(nUsefulThreads > 1 || readAhead > 0)
+        ROOT::EnableThreadSafety();
+
+    Bool_t ok;
+    if(!scan.IsEmpty())
+    {
+        nThreads = nUsefulThreads;
+        if(isVerbose)
+        {
+            scan.Print();
+            if(nThreads > 1)
+                cout << "AnalyzerWT>> Running on " << nThreads << " threads (ordered output)" << endl;
+        }
+        ok = RunScan();
+    }
+    else if(nUsefulThreads <= 1)
+    {
+        ok = RunSequential();
+    }
+    else
+    {
+        nThreads = nUsefulThreads;
+        if(isVerbose)
+            cout << "AnalyzerWT>> Running on " << nThreads << " threads" << (isOrdered ? " (ordered output)" : "") << endl;
+        // Checkpoints and caches are per block: one file per thread
+        ok = (isOrdered || checkpointEntries > 0 || !cacheOutputFilename.empty()) ? RunParallelOrdered() : RunParallelUnordered();
+    }
+    for(Int_t k = 0; ok && isShard && k < TMath::Max(scan.GetSize(), 1); k++)
+        ok = WriteShardInfo(scan.IsEmpty() ? outputFilename : scan.GetFilename(outputFilename, k), {firstEntry, lastEntry, totalEntries, inputUUID});
+
+    if(isVerbose)
+    {
+        cout << endl;
+        PrintReadAheadStats();
+        cout << "AnalyzerWT>> Time grids: " << calibration->GetNGrids() << " (" << calibration->GetNClasses() << " calibrations)" << endl;
+    }
+
+    return ok;
+}
+
+
+
+Bool_t LoopAnalyzer::SetEntries(Long64_t totalEntries)
+{
+    if(nShards > 1)
+    {
+        firstEntry = totalEntries * shard / nShards;
+        lastEntry = totalEntries * (shard + 1) / nShards;
+    }
+    if(lastEntry < 0 || lastEntry > totalEntries)
+        lastEntry = totalEntries;
+    firstEntry = TMath::Min(TMath::Max(firstEntry, 0LL), lastEntry);
+    nEntries = lastEntry - firstEntry;
+
+    return nEntries < totalEntries;
+}
+
+
+
+Bool_t LoopAnalyzer::RunSequential()
+{
+    if(!AnalyzeBlock(outputFilename, firstEntry, lastEntry, cacheOutputFilename))
+        return false;
+
+    CheckpointLYSO::Remove(outputFilename);
+    return true;
+}
+
+
+
+Bool_t LoopAnalyzer::RunParallelOrdered()
+{
+    // Every thread analyzes one contiguous block of entries into its own
+    // part file, then the parts are merged back in block order
+    vector<string> partFilenames(nThreads);
+    vector<string> cacheFilenames(nThreads);
+    vector<thread> workers;
+    atomic<Bool_t> ok{true};
+
+    for(Int_t t = 0; t < nThreads; t++)
+    {
+        Long64_t first = firstEntry + nEntries * t / nThreads;
+        Long64_t last = firstEntry + nEntries * (t + 1) / nThreads;
+        partFilenames[t] = ShardFilename(outputFilename, "part" + to_string(t));
+        if(!cacheOutputFilename.empty())
+            cacheFilenames[t] = ShardFilename(cacheOutputFilename, "part" + to_string(t));
+
+        workers.emplace_back([this, first, last, &ok, &partFilename = partFilenames[t], &cacheFilename = cacheFilenames[t]]()
+        {
+            if(!AnalyzeBlock(partFilename, first, last, cacheFilename))
+                ok = false;
+        });
+    }
+    for(auto& w : workers)
+        w.join();
+
+    if(!ok)
+        return false;
+
+    // Fast merging: baskets (pages) are copied, the entries are not re-streamed
+    StageTimerLYSO timer(GetMetricsThread("main"));
+    ok = ConcatenateOutputs(outputFilename, partFilenames);
+    if(ok && !cacheOutputFilename.empty())
+        ok = ConcatenateOutputs(cacheOutputFilename, cacheFilenames, {"lyso_channels", "lyso_channels_info"});
+    timer.Lap(StageLYSO::Write);
+    if(!ok)
+        return false;
+
+    for(const auto& part : partFilenames)
+    {
+        gSystem->Unlink(part.c_str());
+        CheckpointLYSO::Remove(part);
+    }
+    for(const auto& part : cacheFilenames)
+    {
+        if(!part.empty())
+            gSystem->Unlink(part.c_str());
+    }
+
+    return true;
+}
+
+
+
+Bool_t LoopAnalyzer::AnalyzeBlock(const string& filename, Long64_t first, Long64_t last, const string& cacheFilename)
+{
+    if(checkpointEntries <= 0)
+    {
+        ReadAheadLYSO input(barFilename.c_str(), calibration, first, last, readAhead, readers, metrics.get());
+        auto outFile = OutputFileLYSO::Create(outputFormat, outputTier, filename);
+        if(!input.IsValid() || !outFile)
+            return false;
+
+        unique_ptr<ChannelCacheFileLYSO> cacheFile;
+        if(!cacheFilename.empty())
+        {
+            Int_t nCircles = cacheCircles >= 0 ? cacheCircles : ConfigAnalyzer::GetInstance()->nCircles_Time;
+            cacheFile = ChannelCacheFileLYSO::Create(cacheFilename, calibration, ParametersMPPC::FromConfig(), nCircles);
+            if(!cacheFile)
+                return false;
+        }
+
+        {
+            auto output = outFile->CreateWriter();
+            auto cache = cacheFile ? cacheFile->CreateWriter() : nullptr;
+            AnalyzeEntries(input, *output, cache.get());
+        }
+
+        StageTimerLYSO timer(GetMetricsThread("analysis"));
+        Bool_t ok = outFile->Close();
+        ok = (!cacheFile || cacheFile->Close()) && ok;
+        timer.Lap(StageLYSO::Write);
+        return ok;
+    }
+
+    // Chunks of checkpointEntries, a restarted run goes on from the last one
+    CheckpointLYSO checkpoint(filename, barFilename, inputUUID, first, last, GetRunHash());
+    Long64_t start = checkpoint.GetResumeEntry();
+    if(start > first)
+    {
+        nProcessed += start - first;
+        if(isVerbose)
+        {
+            lock_guard<mutex> lock(printMutex);
+            cout << "AnalyzerWT>> " << filename << ": resuming from entry " << start << endl;
+        }
+    }
+    if(checkpoint.IsComplete())
+        return true;
+
+    ReadAheadLYSO input(barFilename.c_str(), calibration, start, last, readAhead, readers, metrics.get());
+    if(!input.IsValid())
+        return false;
+
+    while(start < last)
+    {
+        Long64_t end = TMath::Min(start + checkpointEntries, last);
+
+        auto outFile = OutputFileLYSO::Create(outputFormat, outputTier, checkpoint.GetChunkFilename(start));
+        if(!outFile)
+            return false;
+        {
+            auto output = outFile->CreateWriter();
+            AnalyzeEntries(input, *output, nullptr, end - start);
+        }
+        StageTimerLYSO timer(GetMetricsThread("analysis"));
+        if(!outFile->Close() || !checkpoint.Commit(start, end))
+            return false;
+        timer.Lap(StageLYSO::Write);
+
+        start = end;
+    }
+
+    StageTimerLYSO timer(GetMetricsThread("analysis"));
+    Bool_t ok = checkpoint.Finalize();
+    timer.Lap(StageLYSO::Write);
+    return ok;
+}
+
+
+
+Bool_t LoopAnalyzer::RunScan()
+{
+    // Every thread analyzes one contiguous block of entries with every
+    // configuration, into one part file per configuration
+    Int_t nPoints = scan.GetSize();
+    vector<vector<string>> partFilenames(nThreads, vector<string>(nPoints));
+    for(Int_t t = 0; t < nThreads; t++)
+    {
+        for(Int_t k = 0; k < nPoints; k++)
+        {
+            string filename = scan.GetFilename(outputFilename, k);
+            partFilenames[t][k] = nThreads > 1 ? ShardFilename(filename, "part" + to_string(t)) : filename;
+        }
+    }
+
+    vector<thread> workers;
+    atomic<Bool_t> ok{true};
+    for(Int_t t = 0; t < nThreads; t++)
+    {
+        Long64_t first = firstEntry + nEntries * t / nThreads;
+        Long64_t last = firstEntry + nEntries * (t + 1) / nThreads;
+
+        workers.emplace_back([this, first, last, &ok, &filenames = partFilenames[t]]()
+        {
+            if(!AnalyzeScanBlock(filenames, first, last))
+                ok = false;
+        });
+    }
+    for(auto& w : workers)
+        w.join();
+
+    StageTimerLYSO timer(GetMetricsThread("main"));
+    for(Int_t k = 0; ok && k < nPoints; k++)
+    {
+        string filename = scan.GetFilename(outputFilename, k);
+        if(nThreads > 1)
+        {
+            vector<string> parts;
+            for(Int_t t = 0; t < nThreads; t++)
+                parts.push_back(partFilenames[t][k]);
+            ok = ConcatenateOutputs(filename, parts);
+            for(const auto& part : parts)
+                gSystem->Unlink(part.c_str());
+        }
+        ok = ok && scan.WriteConfig(filename, k);
+    }
+    timer.Lap(StageLYSO::Write);
+
+    return ok;
+}
+
+
+
+Bool_t LoopAnalyzer::AnalyzeScanBlock(const vector<string>& filenames, Long64_t first, Long64_t last)
+{
+    ReadAheadLYSO input(barFilename.c_str(), calibration, first, last, readAhead, readers, metrics.get());
+    if(!input.IsValid())
+        return false;
+
+    vector<unique_ptr<OutputFileLYSO>> outFiles;
+    for(const auto& filename : filenames)
+    {
+        outFiles.push_back(OutputFileLYSO::Create(outputFormat, outputTier, filename));
+        if(!outFiles.back())
+            return false;
+    }
+
+    {
+        vector<unique_ptr<OutputLYSO>> outputs;
+        for(auto& outFile : outFiles)
+            outputs.push_back(outFile->CreateWriter());
+
+        // One event for the whole run, reloaded with every entry
+        auto eventlyso = make_unique<EventLYSO>();
+        unique_ptr<DecodedEventLYSO> decoded;
+        MetricsThreadLYSO* stats = GetMetricsThread("analysis");
+        while(input.Pop(decoded))
+        {
+            StageTimerLYSO timer(stats);
+            eventlyso->Load(decoded->event, decoded->times, move(decoded->samples));
+            timer.Lap(StageLYSO::Construct);
+            scan.ForEachPoint(*eventlyso, [&outputs](Int_t k, const EventLYSO& event)
+            {
+                outputs[k]->Fill(event);
+            }, &timer);
+            if(stats)
+                stats->AddEvent();
+
+            decoded->samples = eventlyso->ReleaseSamples();
+            input.Recycle(move(decoded));
+
+            PrintProgress();
+        }
+    }
+
+    {
+        lock_guard<mutex> lock(printMutex);
+        readAheadStats += input.GetStats();
+    }
+
+    StageTimerLYSO timer(GetMetricsThread("analysis"));
+    Bool_t ok = true;
+    for(auto& outFile : outFiles)
+        ok = outFile->Close() && ok;
+    timer.Lap(StageLYSO::Write);
+
+    return ok;
+}
+
+
+
+ULong64_t LoopAnalyzer::GetRunHash() const
+{
+    // Config, output content and time calibration of the run. Not the SIMD
+    // level: the kernels give the same results at every level, a resume on
+    // another CPU keeps the committed chunks
+    ULong64_t hash = ConfigAnalyzer::GetInstance()->GetHash();
+    hash = hash * 31 + (ULong64_t)outputFormat;
+    return hash;
+}
+
+
+
+Bool_t LoopAnalyzer::RunParallelUnordered()
+{
+    // Every thread analyzes one contiguous block of entries and writes into
+    // the same file (TBufferMerger or RNTupleParallelWriter): output order
+    // follows flush order
+    auto outFile = OutputFileLYSO::Create(outputFormat, outputTier, outputFilename, true);
+    if(!outFile)
+        return false;
+
+    vector<thread> workers;
+    atomic<Bool_t> ok{true};
+
+    for(Int_t t = 0; t < nThreads; t++)
+    {
+        Long64_t first = firstEntry + nEntries * t / nThreads;
+        Long64_t last = firstEntry + nEntries * (t + 1) / nThreads;
+
+        workers.emplace_back([this, first, last, &outFile, &ok]()
+        {
+            ReadAheadLYSO input(barFilename.c_str(), calibration, first, last, readAhead, readers, metrics.get());
+            if(!input.IsValid())
+            {
+                ok = false;
+                return;
+            }
+            auto output = outFile->CreateWriter();
+
+            AnalyzeEntries(input, *output);
+        });
+    }
+    for(auto& w : workers)
+        w.join();
+
+    StageTimerLYSO timer(GetMetricsThread("main"));
+    Bool_t closed = outFile->Close();
+    timer.Lap(StageLYSO::Write);
+
+    return closed && ok;
+}
+
+
+
+Bool_t LoopAnalyzer::RunGlobalStage()
+{
+    ChannelCacheLYSO cache(cacheInputFilename.c_str());
+    if(!cache.IsValid())
+        return false;
+
+    // The per-channel stage of the cache must be the one of this config
+    auto config = ConfigAnalyzer::GetInstance();
+    if(cache.GetHash() != ParametersMPPC::FromConfig().GetHash())
+    {
+        cerr << "Channel cache " << cacheInputFilename << " made with other trgLevel, lowBase/upBase or lowInt/upInt" << endl;
+        return false;
+    }
+    if(config->nCircles_Time > cache.GetCircles())
+    {
+        cerr << "nCircles_Time = " << config->nCircles_Time << " but the channel cache " << cacheInputFilename
+             << " keeps the waveforms within " << cache.GetCircles() << " circles" << endl;
+        return false;
+    }
+
+    Bool_t isShard = SetEntries(cache.GetEntries());
+    inputUUID = cache.GetUUID();
+    if(isVerbose)
+    {
+        cout << "AnalyzerWT>> Global stage on the channel cache " << cacheInputFilename << endl;
+        cout << "AnalyzerWT>> Entries = " << nEntries;
+        if(isShard)
+            cout << " [" << firstEntry << ", " << lastEntry << ") of " << cache.GetEntries();
+        cout << endl;
+        cout << "AnalyzerWT>> Output: " << GetOutputFormatName(outputFormat) << ", " << GetOutputTierName(outputTier) << " tier" << endl;
+    }
+
+    nProcessed = 0;
+    startTime = chrono::steady_clock::now();
+    auto outFile = OutputFileLYSO::Create(outputFormat, outputTier, outputFilename);
+    if(!outFile)
+        return false;
+
+    {
+        auto output = outFile->CreateWriter();
+        MetricsThreadLYSO* stats = GetMetricsThread("analysis");
+        for(Long64_t k = firstEntry; k < lastEntry; k++)
+        {
+            StageTimerLYSO timer(stats);
+            EventLYSO& eventlyso = cache.GetEntry(k);
+            timer.Lap(StageLYSO::GetEntry);
+            eventlyso.MeasureDetectorCharge();
+            timer.Lap(StageLYSO::Charge);
+            eventlyso.MeasureDetectorTime();
+            timer.Lap(StageLYSO::Time);
+            eventlyso.MeasureDetectorPosition();
+            timer.Lap(StageLYSO::Position);
+
+            output->Fill(eventlyso);
+            timer.Lap(StageLYSO::Fill);
+            if(stats)
+                stats->AddEvent();
+
+            PrintProgress();
+        }
+    }
+
+    StageTimerLYSO timer(GetMetricsThread("analysis"));
+    Bool_t ok = outFile->Close();
+    timer.Lap(StageLYSO::Write);
+    if(ok && isShard)
+        ok = WriteShardInfo(outputFilename, {firstEntry, lastEntry, cache.GetEntries(), inputUUID});
+    if(isVerbose)
+        cout << endl;
+
+    return ok;
+}
+
+
+
+Long64_t LoopAnalyzer::AnalyzeEntries(ReadAheadLYSO& input, OutputLYSO& output, OutputLYSO* cache, Long64_t maxEntries)
+{
+    // One event for all the entries, reloaded with every one
+    auto eventlyso = make_unique<EventLYSO>();
+    const ParametersMPPC par = ParametersMPPC::FromConfig();
+    unique_ptr<DecodedEventLYSO> decoded;
+    Long64_t n = 0;
+    MetricsThreadLYSO* stats = GetMetricsThread("analysis");
+
+    while((maxEntries < 0 || n < maxEntries) && input.Pop(decoded))
+    {
+        StageTimerLYSO timer(stats);
+        eventlyso->Load(decoded->event, decoded->times, move(decoded->samples));
+        timer.Lap(StageLYSO::Construct);
+        eventlyso->CalculateEstimatorsForEveryMPPC(par);
+        timer.Lap(StageLYSO::Channels);
+        eventlyso->MeasureDetectorCharge();
+        timer.Lap(StageLYSO::Charge);
+        eventlyso->MeasureDetectorTime(ConfigAnalyzer::GetInstance()->nCircles_Time, par);
+        timer.Lap(StageLYSO::Time);
+        eventlyso->MeasureDetectorPosition();
+        timer.Lap(StageLYSO::Position);
+
+        output.Fill(*eventlyso);
+        if(cache)
+            cache->Fill(*eventlyso);
+        timer.Lap(StageLYSO::Fill);
+        if(stats)
+            stats->AddEvent();
+
+        decoded->samples = eventlyso->ReleaseSamples();
+        input.Recycle(move(decoded));
+        n++;
+
+        PrintProgress();
+    }
+
+    // Once per input
+    if(maxEntries < 0 || !input.HasNext())
+    {
+        lock_guard<mutex> lock(printMutex);
+        readAheadStats += input.GetStats();
+    }
+
+    return n;
+}
+
+
+
+void LoopAnalyzer::PrintProgress()
+{
+    Long64_t k = nProcessed++;
+
+    if(isVerbose && (nEntries < 10 || k % (nEntries / 10) == 0))
+    {
+        Double_t elapsed = chrono::duration<Double_t>(chrono::steady_clock::now() - startTime).count();
+        lock_guard<mutex> lock(printMutex);
+        cout << "\rAnalyzerWT>> Processed " << k + 1 << " events";
+        if(elapsed > 0)
+            cout << " (" << (Long64_t)((k + 1)/elapsed) << " events/s)";
+        cout << flush;
+    }
+}
+
+
+
+void LoopAnalyzer::PrintReadAheadStats() const
+{
+    // Summed over the analysis threads
+    const ReadAheadStats& st = readAheadStats;
+    cout << "AnalyzerWT>> Read: " << st.read << " s";
+    if(readAhead > 0)
+    {
+        cout << " on " << readers << " I/O thread(s) per analysis thread, queue of " << readAhead << endl;
+        cout << "AnalyzerWT>> Stalls: I/O waiting for room " << st.readerStall << " s (analysis-bound), "
+             << "analysis waiting for events " << st.consumerStall << " s (I/O-bound)";
+    }
+    cout << endl;
+}
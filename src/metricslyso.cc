@@ -0,0 +1,649 @@
+#include "metricslyso.hh"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <ctime>
+
+#include <TSystem.h>
+
+using namespace std;
+
+
+namespace
+{
+    const char* stageNames[(Int_t)StageLYSO::N] = {"get_entry", "pack", "construct", "channels", "charge", "time", "position", "fill", "write"};
+    const char* kernelNames[(Int_t)KernelLYSO::N] = {"windows", "times_cf", "sum_waveforms"};
+
+    // Prometheus buckets: 2^k ns, 64 ns to ~69 s
+    constexpr Int_t minOctave = 6;
+    constexpr Int_t maxOctave = 36;
+
+
+
+    // Non-atomic copy of StageCounters, summable over threads
+    struct StageSnapshot
+    {
+        ULong64_t count = 0;
+        ULong64_t sum = 0;
+        ULong64_t max = 0;
+        vector<ULong64_t> bins = vector<ULong64_t>(StageCounters::BINS, 0);
+
+        StageSnapshot& operator+=(const StageCounters& c)
+        {
+            count += c.count.load(memory_order_relaxed);
+            sum += c.sum.load(memory_order_relaxed);
+            max = std::max<ULong64_t>(max, c.max.load(memory_order_relaxed));
+            for(Int_t b = 0; b < StageCounters::BINS; b++)
+                bins[b] += c.bins[b].load(memory_order_relaxed);
+            return *this;
+        }
+
+        // Upper edge of the bin of quantile q, in s
+        Double_t GetQuantile(Double_t q) const
+        {
+            ULong64_t total = 0;
+            for(auto n : bins)
+                total += n;
+            if(total == 0)
+                return 0.;
+
+            ULong64_t cumulative = 0;
+            for(Int_t b = 0; b < StageCounters::BINS; b++)
+            {
+                cumulative += bins[b];
+                if(cumulative >= q*total)
+                    return std::min(StageCounters::GetBinEdge(b), max)*1e-9;
+            }
+            return max*1e-9;
+        }
+    };
+
+
+
+    // Non-atomic copy of HwTotals, summable over threads
+    struct HwSnapshot
+    {
+        ULong64_t calls = 0;
+        ULong64_t items = 0;
+        ULong64_t counts[HwCountersLYSO::N] = {};
+
+        HwSnapshot& operator+=(const HwTotals& h)
+        {
+            calls += h.calls.load(memory_order_relaxed);
+            items += h.items.load(memory_order_relaxed);
+            for(Int_t e = 0; e < HwCountersLYSO::N; e++)
+                counts[e] += h.counts[e].load(memory_order_relaxed);
+            return *this;
+        }
+    };
+
+
+
+    // Hardware totals of the threads with counters
+    void SumHw(const vector<shared_ptr<MetricsThreadLYSO>>& threads, HwSnapshot stages[], HwSnapshot kernels[])
+    {
+        for(const auto& t : threads)
+        {
+            if(!t->HasHw())
+                continue;
+            for(Int_t s = 0; s < (Int_t)StageLYSO::N; s++)
+                stages[s] += t->GetHwStage((StageLYSO)s);
+            for(Int_t k = 0; k < (Int_t)KernelLYSO::N; k++)
+                kernels[k] += t->GetHwKernel((KernelLYSO)k);
+        }
+    }
+
+
+
+    // The calling thread: a serial number never given to another thread, and
+    // its counters with hardware events, closed when it exits (the perf_event
+    // fds count only the thread that opened them)
+    struct ThreadOwner
+    {
+        ULong64_t serial;
+        vector<weak_ptr<MetricsThreadLYSO>> hwCounters;
+
+        ThreadOwner()
+        {
+            static atomic<ULong64_t> nextSerial{0};
+            serial = nextSerial++;
+        }
+
+        ~ThreadOwner()
+        {
+            for(auto& c : hwCounters)
+            {
+                if(auto counters = c.lock())
+                    counters->DisableHw();
+            }
+        }
+    };
+
+    thread_local ThreadOwner owner;
+
+
+
+    Bool_t WriteAside(const string& filename, const string& content)
+    {
+        string tmpFilename = filename + ".tmp";
+        {
+            ofstream file(tmpFilename);
+            if(!file.is_open())
+            {
+                cerr << "Error opening file: " << tmpFilename << endl;
+                return false;
+            }
+            file << content;
+            if(!file)
+                return false;
+        }
+
+        return gSystem->Rename(tmpFilename.c_str(), filename.c_str()) == 0;
+    }
+}
+
+
+
+const char* GetStageName(StageLYSO stage)
+{
+    return stageNames[(Int_t)stage];
+}
+
+
+
+const char* GetKernelName(KernelLYSO kernel)
+{
+    return kernelNames[(Int_t)kernel];
+}
+
+
+
+thread_local MetricsThreadLYSO* KernelScopeLYSO::current = nullptr;
+
+
+
+Bool_t MetricsThreadLYSO::EnableHw(string& status)
+{
+    fHw = make_unique<HwCountersLYSO>();
+    status = fHw->GetStatus();
+    if(!fHw->IsValid())
+        fHw.reset();
+    isHw = fHw != nullptr;
+
+    return isHw;
+}
+
+
+
+Int_t StageCounters::GetBin(ULong64_t ns)
+{
+    if(ns < 4)
+        return ns;
+
+    // Octave e and its quarter
+    Int_t e = 63 - __builtin_clzll(ns);
+    Int_t bin = 4 + (e - 2)*4 + (Int_t)(ns >> (e - 2)) - 4;
+    return bin < BINS ? bin : BINS - 1;
+}
+
+
+
+ULong64_t StageCounters::GetBinEdge(Int_t bin)
+{
+    if(bin < 4)
+        return bin + 1;
+
+    Int_t e = (bin - 4)/4 + 2;
+    return (ULong64_t)(5 + (bin - 4)%4) << (e - 2);
+}
+
+
+
+MetricsLYSO::MetricsLYSO(const string& prefix, Double_t period, Bool_t hw)
+    : fPrefix(prefix), fPeriod(period), isHwEnabled(hw), fStart(chrono::steady_clock::now())
+{
+    fill(fHwHas, fHwHas + HwCountersLYSO::N, true);
+}
+
+
+
+MetricsLYSO::~MetricsLYSO()
+{
+    {
+        lock_guard<mutex> lock(fExportMutex);
+        isStopping = true;
+    }
+    fStopCV.notify_all();
+    if(fExporter.joinable())
+        fExporter.join();
+}
+
+
+
+MetricsThreadLYSO* MetricsLYSO::GetThread(const string& role)
+{
+    lock_guard<mutex> lock(fMutex);
+
+    auto key = make_pair(owner.serial, role);
+    auto it = fIndex.find(key);
+    if(it != fIndex.end())
+    {
+        KernelScopeLYSO::SetThread(it->second);
+        return it->second;
+    }
+
+    fThreads.push_back(make_shared<MetricsThreadLYSO>(role + "-" + to_string(fRoles[role]++)));
+    MetricsThreadLYSO* counters = fThreads.back().get();
+    fIndex[key] = counters;
+
+    // Counters follow the thread that opens them: opened here, by the thread
+    if(isHwEnabled)
+    {
+        string status;
+        if(counters->EnableHw(status))
+        {
+            owner.hwCounters.push_back(fThreads.back());
+            nHwThreads++;
+            for(Int_t e = 0; e < HwCountersLYSO::N; e++)
+                fHwHas[e] = fHwHas[e] && counters->GetHw()->Has((HwEventLYSO)e);
+        }
+        if(fHwStatus.empty())
+        {
+            fHwStatus = status;
+            cout << "AnalyzerWT>> Hardware counters: " << status << endl;
+        }
+    }
+    KernelScopeLYSO::SetThread(counters);
+
+    return counters;
+}
+
+
+
+void MetricsLYSO::Start()
+{
+    fStart = chrono::steady_clock::now();
+    if(fPeriod <= 0 || fPrefix.empty() || fExporter.joinable())
+        return;
+
+    fExporter = thread([this]()
+    {
+        unique_lock<mutex> lock(fExportMutex);
+        while(!fStopCV.wait_for(lock, chrono::duration<Double_t>(fPeriod), [this] { return isStopping; }))
+        {
+            lock.unlock();
+            Export();
+            lock.lock();
+        }
+    });
+}
+
+
+
+Bool_t MetricsLYSO::Stop()
+{
+    {
+        lock_guard<mutex> lock(fExportMutex);
+        isStopping = true;
+    }
+    fStopCV.notify_all();
+    if(fExporter.joinable())
+        fExporter.join();
+
+    return Export();
+}
+
+
+
+Bool_t MetricsLYSO::Export()
+{
+    if(fPrefix.empty())
+        return true;
+
+    Bool_t ok = WriteJSON(fPrefix + ".json");
+    return WritePrometheus(fPrefix + ".prom") && ok;
+}
+
+
+
+ULong64_t MetricsLYSO::GetEvents()
+{
+    lock_guard<mutex> lock(fMutex);
+    ULong64_t events = 0;
+    for(const auto& t : fThreads)
+        events += t->GetEvents();
+    return events;
+}
+
+
+
+Double_t MetricsLYSO::GetElapsed() const
+{
+    return chrono::duration<Double_t>(chrono::steady_clock::now() - fStart).count();
+}
+
+
+
+void MetricsLYSO::Print()
+{
+    StageSnapshot total[(Int_t)StageLYSO::N];
+    {
+        lock_guard<mutex> lock(fMutex);
+        for(const auto& t : fThreads)
+        {
+            for(Int_t s = 0; s < (Int_t)StageLYSO::N; s++)
+                total[s] += t->GetStage((StageLYSO)s);
+        }
+    }
+
+    ULong64_t events = GetEvents();
+    Double_t elapsed = GetElapsed();
+    cout << "AnalyzerWT>> Metrics: " << events << " events in " << elapsed << " s, " << events/elapsed << " events/s" << endl;
+    cout << "AnalyzerWT>>   stage          count     mean [us]   p50 [us]   p99 [us]   max [us]   total [s]" << endl;
+    for(Int_t s = 0; s < (Int_t)StageLYSO::N; s++)
+    {
+        const StageSnapshot& st = total[s];
+        if(st.count == 0)
+            continue;
+        cout << "AnalyzerWT>>   " << left << setw(10) << stageNames[s] << right << setw(10) << st.count
+             << fixed << setprecision(2)
+             << setw(14) << st.sum*1e-3/st.count << setw(11) << st.GetQuantile(0.5)*1e6
+             << setw(11) << st.GetQuantile(0.99)*1e6 << setw(11) << st.max*1e-3
+             << setprecision(3) << setw(12) << st.sum*1e-9 << defaultfloat << endl;
+    }
+
+    if(isHwEnabled)
+        PrintHw();
+}
+
+
+
+void MetricsLYSO::PrintHw()
+{
+    constexpr Int_t N = HwCountersLYSO::N;
+    HwSnapshot stages[(Int_t)StageLYSO::N];
+    HwSnapshot kernels[(Int_t)KernelLYSO::N];
+    {
+        lock_guard<mutex> lock(fMutex);
+        if(nHwThreads == 0)
+        {
+            cout << "AnalyzerWT>> Hardware counters: " << fHwStatus << ", no profile" << endl;
+            return;
+        }
+        SumHw(fThreads, stages, kernels);
+    }
+
+    ULong64_t events = max<ULong64_t>(GetEvents(), 1);
+    auto printRow = [this](const string& name, const HwSnapshot& h, Double_t norm)
+    {
+        cout << "AnalyzerWT>>   " << left << setw(20) << name << right;
+        for(Int_t e = 0; e < N; e++)
+        {
+            if(fHwHas[e])
+                cout << setw(15) << fixed << setprecision(1) << h.counts[e]/norm;
+            else
+                cout << setw(15) << "-";
+        }
+        Double_t cycles = h.counts[(Int_t)HwEventLYSO::Cycles];
+        if(fHwHas[(Int_t)HwEventLYSO::Cycles] && fHwHas[(Int_t)HwEventLYSO::Instructions] && cycles > 0)
+            cout << setw(8) << setprecision(2) << h.counts[(Int_t)HwEventLYSO::Instructions]/cycles;
+        else
+            cout << setw(8) << "-";
+        cout << defaultfloat << endl;
+    };
+    auto printHeader = [](const string& title)
+    {
+        cout << "AnalyzerWT>>   " << left << setw(20) << title << right;
+        for(Int_t e = 0; e < N; e++)
+            cout << setw(15) << GetHwEventName((HwEventLYSO)e);
+        cout << setw(8) << "IPC" << endl;
+    };
+
+    cout << "AnalyzerWT>> Hardware counters per event (user space, " << nHwThreads << " threads)" << endl;
+    printHeader("region");
+    for(Int_t s = 0; s < (Int_t)StageLYSO::N; s++)
+    {
+        // Write is once per file, not per event
+        if(stages[s].calls > 0 && s != (Int_t)StageLYSO::Write)
+            printRow(string("stage ") + stageNames[s], stages[s], events);
+    }
+    for(Int_t k = 0; k < (Int_t)KernelLYSO::N; k++)
+    {
+        if(kernels[k].calls > 0)
+            printRow(string("kernel ") + kernelNames[k], kernels[k], events);
+    }
+
+    cout << "AnalyzerWT>> Hardware counters per channel" << endl;
+    printHeader("kernel");
+    for(Int_t k = 0; k < (Int_t)KernelLYSO::N; k++)
+    {
+        if(kernels[k].items > 0)
+            printRow(kernelNames[k], kernels[k], kernels[k].items);
+    }
+}
+
+
+
+Bool_t MetricsLYSO::WriteJSON(const string& filename)
+{
+    ostringstream out;
+    out.precision(9);
+
+    auto writeStages = [&out](const StageSnapshot* stages, const string& indent)
+    {
+        out << indent << "\"stages\": {" << endl;
+        Bool_t isFirst = true;
+        for(Int_t s = 0; s < (Int_t)StageLYSO::N; s++)
+        {
+            const StageSnapshot& st = stages[s];
+            if(st.count == 0)
+                continue;
+            out << (isFirst ? "" : ",\n") << indent << "  \"" << stageNames[s] << "\": {"
+                << "\"count\": " << st.count
+                << ", \"sum_seconds\": " << st.sum*1e-9
+                << ", \"mean_seconds\": " << st.sum*1e-9/st.count
+                << ", \"p50_seconds\": " << st.GetQuantile(0.5)
+                << ", \"p90_seconds\": " << st.GetQuantile(0.9)
+                << ", \"p99_seconds\": " << st.GetQuantile(0.99)
+                << ", \"max_seconds\": " << st.max*1e-9
+                << ", \"buckets\": [";
+            // Non-empty bins only, [upper edge in s, count]
+            Bool_t isFirstBin = true;
+            for(Int_t b = 0; b < StageCounters::BINS; b++)
+            {
+                if(st.bins[b] == 0)
+                    continue;
+                out << (isFirstBin ? "" : ", ") << "[" << StageCounters::GetBinEdge(b)*1e-9 << ", " << st.bins[b] << "]";
+                isFirstBin = false;
+            }
+            out << "]}";
+            isFirst = false;
+        }
+        out << endl << indent << "}";
+    };
+
+    StageSnapshot total[(Int_t)StageLYSO::N];
+    vector<pair<string, vector<StageSnapshot>>> threads;
+    ULong64_t events = 0;
+    HwSnapshot hwStages[(Int_t)StageLYSO::N];
+    HwSnapshot hwKernels[(Int_t)KernelLYSO::N];
+    {
+        lock_guard<mutex> lock(fMutex);
+        for(const auto& t : fThreads)
+        {
+            vector<StageSnapshot> stages((Int_t)StageLYSO::N);
+            for(Int_t s = 0; s < (Int_t)StageLYSO::N; s++)
+            {
+                stages[s] += t->GetStage((StageLYSO)s);
+                total[s] += t->GetStage((StageLYSO)s);
+            }
+            threads.emplace_back(t->GetName(), move(stages));
+            events += t->GetEvents();
+        }
+        SumHw(fThreads, hwStages, hwKernels);
+    }
+
+    // Hardware counters of the regions of one kind, events not opened by every thread left out
+    auto writeHw = [this, &out](const char* kind, const HwSnapshot* regions, Int_t n, const char* const names[])
+    {
+        out << "    \"" << kind << "\": {" << endl;
+        Bool_t isFirst = true;
+        for(Int_t r = 0; r < n; r++)
+        {
+            if(regions[r].calls == 0)
+                continue;
+            out << (isFirst ? "" : ",\n") << "      \"" << names[r] << "\": {\"calls\": " << regions[r].calls << ", \"items\": " << regions[r].items;
+            for(Int_t e = 0; e < HwCountersLYSO::N; e++)
+            {
+                if(fHwHas[e])
+                    out << ", \"" << GetHwEventName((HwEventLYSO)e) << "\": " << regions[r].counts[e];
+            }
+            out << "}";
+            isFirst = false;
+        }
+        out << endl << "    }";
+    };
+
+    Double_t elapsed = GetElapsed();
+
+    out << "{" << endl;
+    out << "  \"host\": \"" << gSystem->HostName() << "\"," << endl;
+    out << "  \"timestamp\": " << time(nullptr) << "," << endl;
+    out << "  \"elapsed_seconds\": " << elapsed << "," << endl;
+    out << "  \"events\": " << events << "," << endl;
+    out << "  \"events_per_second\": " << (elapsed > 0 ? events/elapsed : 0.) << "," << endl;
+    out << "  \"total\": {" << endl;
+    writeStages(total, "    ");
+    out << endl << "  }," << endl;
+    if(isHwEnabled)
+    {
+        out << "  \"hw\": {" << endl;
+        out << "    \"status\": \"" << fHwStatus << "\"," << endl;
+        out << "    \"threads\": " << nHwThreads << "," << endl;
+        writeHw("stages", hwStages, (Int_t)StageLYSO::N, stageNames);
+        out << "," << endl;
+        writeHw("kernels", hwKernels, (Int_t)KernelLYSO::N, kernelNames);
+        out << endl << "  }," << endl;
+    }
+    out << "  \"threads\": [" << endl;
+    for(size_t i = 0; i < threads.size(); i++)
+    {
+        out << "    {" << endl;
+        out << "      \"name\": \"" << threads[i].first << "\"," << endl;
+        writeStages(threads[i].second.data(), "      ");
+        out << endl << "    }" << (i + 1 < threads.size() ? "," : "") << endl;
+    }
+    out << "  ]" << endl;
+    out << "}" << endl;
+
+    return WriteAside(filename, out.str());
+}
+
+
+
+Bool_t MetricsLYSO::WritePrometheus(const string& filename)
+{
+    ostringstream out;
+    out.precision(9);
+
+    string host = gSystem->HostName();
+    vector<pair<string, vector<StageSnapshot>>> threads;
+    ULong64_t events = 0;
+    HwSnapshot hwStages[(Int_t)StageLYSO::N];
+    HwSnapshot hwKernels[(Int_t)KernelLYSO::N];
+    {
+        lock_guard<mutex> lock(fMutex);
+        for(const auto& t : fThreads)
+        {
+            vector<StageSnapshot> stages((Int_t)StageLYSO::N);
+            for(Int_t s = 0; s < (Int_t)StageLYSO::N; s++)
+                stages[s] += t->GetStage((StageLYSO)s);
+            threads.emplace_back(t->GetName(), move(stages));
+            events += t->GetEvents();
+        }
+        SumHw(fThreads, hwStages, hwKernels);
+    }
+    Double_t elapsed = GetElapsed();
+
+    out << "# HELP lyso_info Host of the run" << endl;
+    out << "# TYPE lyso_info gauge" << endl;
+    out << "lyso_info{host=\"" << host << "\"} 1" << endl;
+    out << "# HELP lyso_events_total Events analyzed" << endl;
+    out << "# TYPE lyso_events_total counter" << endl;
+    out << "lyso_events_total " << events << endl;
+    out << "# HELP lyso_elapsed_seconds Time since the start of the run" << endl;
+    out << "# TYPE lyso_elapsed_seconds gauge" << endl;
+    out << "lyso_elapsed_seconds " << elapsed << endl;
+    out << "# HELP lyso_events_per_second Mean rate since the start of the run" << endl;
+    out << "# TYPE lyso_events_per_second gauge" << endl;
+    out << "lyso_events_per_second " << (elapsed > 0 ? events/elapsed : 0.) << endl;
+
+    out << "# HELP lyso_stage_seconds Latency of the stages of the event loop" << endl;
+    out << "# TYPE lyso_stage_seconds histogram" << endl;
+    for(const auto& [name, stages] : threads)
+    {
+        for(Int_t s = 0; s < (Int_t)StageLYSO::N; s++)
+        {
+            const StageSnapshot& st = stages[s];
+            if(st.count == 0)
+                continue;
+
+            string labels = "thread=\"" + name + "\",stage=\"" + stageNames[s] + "\"";
+            ULong64_t cumulative = 0;
+            Int_t octave = minOctave;
+            for(Int_t b = 0; b < StageCounters::BINS && octave <= maxOctave; b++)
+            {
+                cumulative += st.bins[b];
+                ULong64_t edge = StageCounters::GetBinEdge(b);
+                // Bins never cross an octave edge
+                if(edge == (1ULL << octave))
+                {
+                    out << "lyso_stage_seconds_bucket{" << labels << ",le=\"" << edge*1e-9 << "\"} " << cumulative << endl;
+                    octave++;
+                }
+            }
+            out << "lyso_stage_seconds_bucket{" << labels << ",le=\"+Inf\"} " << st.count << endl;
+            out << "lyso_stage_seconds_sum{" << labels << "} " << st.sum*1e-9 << endl;
+            out << "lyso_stage_seconds_count{" << labels << "} " << st.count << endl;
+        }
+    }
+
+    out << "# HELP lyso_stage_max_seconds Slowest call of the stages of the event loop" << endl;
+    out << "# TYPE lyso_stage_max_seconds gauge" << endl;
+    for(const auto& [name, stages] : threads)
+    {
+        for(Int_t s = 0; s < (Int_t)StageLYSO::N; s++)
+        {
+            if(stages[s].count > 0)
+                out << "lyso_stage_max_seconds{thread=\"" << name << "\",stage=\"" << stageNames[s] << "\"} " << stages[s].max*1e-9 << endl;
+        }
+    }
+
+    if(isHwEnabled && nHwThreads > 0)
+    {
+        auto writeHw = [this, &out](const char* kind, const HwSnapshot* regions, Int_t n, const char* const names[])
+        {
+            for(Int_t r = 0; r < n; r++)
+            {
+                if(regions[r].calls == 0)
+                    continue;
+                string labels = string("kind=\"") + kind + "\",region=\"" + names[r] + "\"";
+                out << "lyso_hw_items_total{" << labels << "} " << regions[r].items << endl;
+                for(Int_t e = 0; e < HwCountersLYSO::N; e++)
+                {
+                    if(fHwHas[e])
+                        out << "lyso_hw_events_total{" << labels << ",event=\"" << GetHwEventName((HwEventLYSO)e) << "\"} " << regions[r].counts[e] << endl;
+                }
+            }
+        };
+        out << "# HELP lyso_hw_events_total Hardware counters (user space) of the stages and kernels, all threads" << endl;
+        out << "# TYPE lyso_hw_events_total counter" << endl;
+        out << "# HELP lyso_hw_items_total Channels (kernels) or calls (stages) of the hardware counters" << endl;
+        out << "# TYPE lyso_hw_items_total counter" << endl;
+        writeHw("stage", hwStages, (Int_t)StageLYSO::N, stageNames);
+        writeHw("kernel", hwKernels, (Int_t)KernelLYSO::N, kernelNames);
+    }
+
+    return WriteAside(filename, out.str());
+}
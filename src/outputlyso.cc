@@ -0,0 +1,519 @@
+#include "outputlyso.hh"
+
+#include <vector>
+
+#include <TFile.h>
+#include <TTree.h>
+#include <RVersion.h>
+#include <ROOT/TBufferMerger.hxx>
+
+#ifdef ANALYZER_RNTUPLE
+#include <ROOT/RError.hxx>
+#include <ROOT/RNTupleModel.hxx>
+#include <ROOT/RNTupleWriter.hxx>
+#include <ROOT/RNTupleParallelWriter.hxx>
+#endif
+
+using namespace std;
+using namespace ROOT;
+
+
+Bool_t ParseOutputFormat(const string& name, OutputFormat& format)
+{
+    if(name == "ttree")
+        format = OutputFormat::TTree;
+    else if(name == "rntuple")
+        format = OutputFormat::RNTuple;
+    else
+        return false;
+
+    return true;
+}
+
+
+
+const char* GetOutputFormatName(OutputFormat format)
+{
+    return format == OutputFormat::RNTuple ? "rntuple" : "ttree";
+}
+
+
+
+Bool_t ParseOutputTier(const string& name, OutputTier& tier)
+{
+    if(name == "summary")
+        tier = OutputTier::Summary;
+    else if(name == "triggered")
+        tier = OutputTier::Triggered;
+    else if(name == "full")
+        tier = OutputTier::Full;
+    else
+        return false;
+
+    return true;
+}
+
+
+
+const char* GetOutputTierName(OutputTier tier)
+{
+    switch(tier)
+    {
+        case OutputTier::Summary:   return "summary";
+        case OutputTier::Triggered: return "triggered";
+        default:                    return "full";
+    }
+}
+
+
+
+namespace
+{
+    const char* const faceSuffix[FACES] = {"_F", "_B"};
+
+    string ColumnName(const char* name, Int_t face)
+    {
+        return string(name) + faceSuffix[face];
+    }
+
+
+
+    //------------------------------------------------------------------------//
+    // Flat schema: one column per estimator, shared by the backends
+    //------------------------------------------------------------------------//
+    struct Column
+    {
+        string name;
+        string leaflist;   // TTree leaf list
+        void* treeAddress;
+        string ntupleType; // RNTuple field type, empty if not in the RNTuple
+        void* ntupleAddress;
+    };
+
+
+
+    // Buffer of one entry. Not movable: the columns point into it
+    struct FlatEvent
+    {
+        // Summary
+        Int_t EventAZ;
+        Double_t Charge_Tot;
+        Double_t Charge[FACES];
+        Double_t Time15[FACES][5];
+        Double_t Time25[FACES][5];
+        Double_t Time50[FACES][5];
+        Double_t Centroid[FACES][4]; // x, y, sigmax, sigmay
+        // Triggered channels, never longer than CHANNELS (TTree reads the data in place)
+        Int_t nTrg[FACES];
+        vector<Int_t> TrgCh[FACES];
+        vector<Double_t> TrgCharges[FACES];
+        vector<Double_t> TrgAmplitudes[FACES];
+        vector<Double_t> TrgTimeCFs15[FACES];
+        vector<Double_t> TrgTimeCFs25[FACES];
+        vector<Double_t> TrgTimeCFs50[FACES];
+        // Every channel
+        Double_t Charges[FACES][CHANNELS];
+        Double_t Amplitudes[FACES][CHANNELS];
+        Double_t TimeCFs15[FACES][CHANNELS];
+        Double_t TimeCFs25[FACES][CHANNELS];
+        Double_t TimeCFs50[FACES][CHANNELS];
+        Bool_t Triggers[FACES][CHANNELS];
+
+        const OutputTier tier;
+        vector<Column> columns;
+
+        FlatEvent(OutputTier t);
+        FlatEvent(const FlatEvent&) = delete;
+        FlatEvent& operator=(const FlatEvent&) = delete;
+
+        void Load(const EventLYSO& event);
+    };
+
+
+
+    FlatEvent::FlatEvent(OutputTier t) : tier(t)
+    {
+        auto scalar = [this](const string& name, const char* leafType, const char* ntupleType, void* address)
+        {
+            columns.push_back({name, name + "/" + leafType, address, ntupleType, address});
+        };
+        auto fixed = [this](const string& name, Int_t n, const char* leafType, const char* ntupleType, void* address)
+        {
+            string type = string("std::array<") + ntupleType + "," + to_string(n) + ">";
+            columns.push_back({name, name + "[" + to_string(n) + "]/" + leafType, address, type, address});
+        };
+        // vector: TTree reads n from counter, RNTuple stores the vector itself
+        auto triggered = [this](const string& name, const string& counter, const char* leafType, const char* ntupleType, auto& vec)
+        {
+            vec.reserve(CHANNELS);
+            string type = string("std::vector<") + ntupleType + ">";
+            columns.push_back({name, name + "[" + counter + "]/" + leafType, vec.data(), type, &vec});
+        };
+
+        scalar("EventAZ", "I", "std::int32_t", &EventAZ);
+        scalar("Charge_Tot", "D", "double", &Charge_Tot);
+        for(Int_t face = 0; face < FACES; face++)
+        {
+            scalar(ColumnName("Charge", face), "D", "double", &Charge[face]);
+            fixed(ColumnName("Time15", face), 5, "D", "double", Time15[face]);
+            fixed(ColumnName("Time25", face), 5, "D", "double", Time25[face]);
+            fixed(ColumnName("Time50", face), 5, "D", "double", Time50[face]);
+            fixed(ColumnName("Centroid", face), 4, "D", "double", Centroid[face]);
+        }
+
+        if(tier == OutputTier::Triggered)
+        {
+            for(Int_t face = 0; face < FACES; face++)
+            {
+                string counter = ColumnName("nTrg", face);
+                columns.push_back({counter, counter + "/I", &nTrg[face], "", nullptr});
+                triggered(ColumnName("TrgCh", face), counter, "I", "std::int32_t", TrgCh[face]);
+                triggered(ColumnName("TrgCharges", face), counter, "D", "double", TrgCharges[face]);
+                triggered(ColumnName("TrgAmplitudes", face), counter, "D", "double", TrgAmplitudes[face]);
+                triggered(ColumnName("TrgTimeCFs15", face), counter, "D", "double", TrgTimeCFs15[face]);
+                triggered(ColumnName("TrgTimeCFs25", face), counter, "D", "double", TrgTimeCFs25[face]);
+                triggered(ColumnName("TrgTimeCFs50", face), counter, "D", "double", TrgTimeCFs50[face]);
+            }
+        }
+        else if(tier == OutputTier::Full)
+        {
+            for(Int_t face = 0; face < FACES; face++)
+            {
+                fixed(ColumnName("Charges", face), CHANNELS, "D", "double", Charges[face]);
+                fixed(ColumnName("Amplitudes", face), CHANNELS, "D", "double", Amplitudes[face]);
+                fixed(ColumnName("TimeCFs15", face), CHANNELS, "D", "double", TimeCFs15[face]);
+                fixed(ColumnName("TimeCFs25", face), CHANNELS, "D", "double", TimeCFs25[face]);
+                fixed(ColumnName("TimeCFs50", face), CHANNELS, "D", "double", TimeCFs50[face]);
+                fixed(ColumnName("Triggers", face), CHANNELS, "O", "bool", Triggers[face]);
+            }
+        }
+    }
+
+
+
+    void FlatEvent::Load(const EventLYSO& event)
+    {
+        EventAZ = event.GetEventID();
+        Charge_Tot = event.GetChargeTot();
+        for(Int_t face = 0; face < FACES; face++)
+        {
+            Charge[face] = event.GetCharge(face);
+            copy_n(event.GetTime15(face), 5, Time15[face]);
+            copy_n(event.GetTime25(face), 5, Time25[face]);
+            copy_n(event.GetTime50(face), 5, Time50[face]);
+            copy_n(event.GetCentroid(face), 4, Centroid[face]);
+        }
+
+        if(tier == OutputTier::Triggered)
+        {
+            for(Int_t face = 0; face < FACES; face++)
+            {
+                TrgCh[face].clear();
+                TrgCharges[face].clear();
+                TrgAmplitudes[face].clear();
+                TrgTimeCFs15[face].clear();
+                TrgTimeCFs25[face].clear();
+                TrgTimeCFs50[face].clear();
+
+                const Bool_t* triggers = event.GetTriggers(face);
+                for(Int_t ch = 0; ch < CHANNELS; ch++)
+                {
+                    if(!triggers[ch])
+                        continue;
+                    TrgCh[face].push_back(ch);
+                    TrgCharges[face].push_back(event.GetCharges(face)[ch]);
+                    TrgAmplitudes[face].push_back(event.GetAmplitudes(face)[ch]);
+                    TrgTimeCFs15[face].push_back(event.GetTimeCFs15(face)[ch]);
+                    TrgTimeCFs25[face].push_back(event.GetTimeCFs25(face)[ch]);
+                    TrgTimeCFs50[face].push_back(event.GetTimeCFs50(face)[ch]);
+                }
+                nTrg[face] = TrgCh[face].size();
+            }
+        }
+        else if(tier == OutputTier::Full)
+        {
+            for(Int_t face = 0; face < FACES; face++)
+            {
+                copy_n(event.GetCharges(face), CHANNELS, Charges[face]);
+                copy_n(event.GetAmplitudes(face), CHANNELS, Amplitudes[face]);
+                copy_n(event.GetTimeCFs15(face), CHANNELS, TimeCFs15[face]);
+                copy_n(event.GetTimeCFs25(face), CHANNELS, TimeCFs25[face]);
+                copy_n(event.GetTimeCFs50(face), CHANNELS, TimeCFs50[face]);
+                copy_n(event.GetTriggers(face), CHANNELS, Triggers[face]);
+            }
+        }
+    }
+
+
+
+    //------------------------------------------------------------------------//
+    // TTree: flat branches, or EventLYSO objects in the EventEstimators
+    // branch for the full tier (split by ROOT in one branch per member)
+    //------------------------------------------------------------------------//
+    class TreeOutput : public OutputLYSO
+    {
+      public:
+        // mergerFile: the TBufferMerger file of the tree, flushed periodically
+        TreeOutput(OutputTier tier, TFile* file, shared_ptr<TFile> mergerFile = nullptr)
+            : fFile(file), fMergerFile(move(mergerFile))
+        {
+            fFile->cd();
+            fTree = make_unique<TTree>("lyso_est", "TTree of lyso estimators");
+
+            if(tier == OutputTier::Full)
+            {
+                fTree->Branch("EventEstimators", &fEvent);
+                return;
+            }
+
+            fFlat = make_unique<FlatEvent>(tier);
+            for(const auto& c : fFlat->columns)
+                fTree->Branch(c.name.c_str(), c.treeAddress, c.leaflist.c_str());
+        }
+
+        ~TreeOutput() override
+        {
+            if(fMergerFile)
+            {
+                fMergerFile->Write();
+            }
+            else
+            {
+                // Seen by TreeFile::Close, a destructor can't return it
+                fFile->cd();
+                if(fFile->WriteObject(fTree.get(), "lyso_est") <= 0)
+                    fFile->SetBit(TFile::kWriteError);
+            }
+        }
+
+        void Fill(const EventLYSO& event) override
+        {
+            // Entries buffered by a TBufferMerger file before sending them to the merger
+            constexpr Long64_t flushEntries = 1000;
+
+            if(fFlat)
+                fFlat->Load(event);
+            else
+                fEvent = const_cast<EventLYSO*>(&event);
+            fTree->Fill();
+
+            if(fMergerFile && fTree->GetEntries() % flushEntries == 0)
+                fMergerFile->Write();
+        }
+
+      private:
+        TFile* fFile;
+        shared_ptr<TFile> fMergerFile;
+        unique_ptr<TTree> fTree;
+        unique_ptr<FlatEvent> fFlat;
+        EventLYSO* fEvent = nullptr;
+    };
+
+
+
+    class TreeFile : public OutputFileLYSO
+    {
+      public:
+        TreeFile(OutputTier tier, unique_ptr<TFile> file) : fTier(tier), fFile(move(file)) {}
+
+        unique_ptr<OutputLYSO> CreateWriter() override
+        {
+            return make_unique<TreeOutput>(fTier, fFile.get());
+        }
+
+        Bool_t Close() override
+        {
+            // Write errors of the baskets, of lyso_est and of the keys at Close
+            Bool_t ok = !fFile->TestBit(TFile::kWriteError);
+            fFile->Close();
+            ok = ok && !fFile->TestBit(TFile::kWriteError);
+            if(!ok)
+                cerr << "Error writing file: " << fFile->GetName() << endl;
+            return ok;
+        }
+
+      private:
+        OutputTier fTier;
+        unique_ptr<TFile> fFile;
+    };
+
+
+
+    class MergerTreeFile : public OutputFileLYSO
+    {
+      public:
+        MergerTreeFile(OutputTier tier, const string& filename) : fTier(tier), fMerger(filename.c_str(), "RECREATE") {}
+
+        unique_ptr<OutputLYSO> CreateWriter() override
+        {
+            // Output order follows flush order
+            auto file = fMerger.GetFile();
+            TFile* filePtr = file.get();
+            return make_unique<TreeOutput>(fTier, filePtr, move(file));
+        }
+
+        Bool_t Close() override { return true; }
+
+      private:
+        OutputTier fTier;
+        TBufferMerger fMerger;
+    };
+
+
+
+#ifdef ANALYZER_RNTUPLE
+    //------------------------------------------------------------------------//
+    // RNTuple: one field per column of the flat schema
+    //------------------------------------------------------------------------//
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 36, 0)
+    namespace RNT = ROOT;
+#else
+    namespace RNT = ROOT::Experimental;
+#endif
+
+    unique_ptr<RNT::RNTupleModel> CreateModel(OutputTier tier)
+    {
+        // Bare: entries are created by the writers, one per thread
+        auto model = RNT::RNTupleModel::CreateBare();
+
+        FlatEvent flat(tier);
+        for(const auto& c : flat.columns)
+        {
+            if(!c.ntupleType.empty())
+                model->AddField(RNT::RFieldBase::Create(c.name, c.ntupleType).Unwrap());
+        }
+
+        return model;
+    }
+
+
+
+    // Filler is RNTupleWriter (one thread) or RNTupleFillContext (one per thread)
+    template <class Filler>
+    class NTupleOutput : public OutputLYSO
+    {
+      public:
+        NTupleOutput(OutputTier tier, shared_ptr<Filler> filler)
+            : fFiller(move(filler)), fEntry(fFiller->CreateEntry()), fFlat(tier)
+        {
+            // The entry reads the flat buffer in place
+            for(const auto& c : fFlat.columns)
+            {
+                if(!c.ntupleType.empty())
+                    fEntry->BindRawPtr(c.name, c.ntupleAddress);
+            }
+        }
+
+        void Fill(const EventLYSO& event) override
+        {
+            fFlat.Load(event);
+            fFiller->Fill(*fEntry);
+        }
+
+      private:
+        shared_ptr<Filler> fFiller;
+        unique_ptr<RNT::REntry> fEntry;
+        FlatEvent fFlat;
+    };
+
+
+
+    class NTupleFile : public OutputFileLYSO
+    {
+      public:
+        NTupleFile(OutputTier tier, unique_ptr<RNT::RNTupleWriter> writer) : fTier(tier), fWriter(move(writer)) {}
+
+        unique_ptr<OutputLYSO> CreateWriter() override
+        {
+            return make_unique<NTupleOutput<RNT::RNTupleWriter>>(fTier, fWriter);
+        }
+
+        Bool_t Close() override
+        {
+            try
+            {
+                // Commits the dataset
+                fWriter.reset();
+            }
+            catch(const RException& e)
+            {
+                cerr << "Error writing RNTuple lyso_est: " << e.what() << endl;
+                return false;
+            }
+            return true;
+        }
+
+      private:
+        OutputTier fTier;
+        shared_ptr<RNT::RNTupleWriter> fWriter;
+    };
+
+
+
+    class ParallelNTupleFile : public OutputFileLYSO
+    {
+      public:
+        ParallelNTupleFile(OutputTier tier, unique_ptr<RNT::RNTupleParallelWriter> writer) : fTier(tier), fWriter(move(writer)) {}
+
+        unique_ptr<OutputLYSO> CreateWriter() override
+        {
+            // Every context writes its own clusters
+            return make_unique<NTupleOutput<RNT::RNTupleFillContext>>(fTier, fWriter->CreateFillContext());
+        }
+
+        Bool_t Close() override
+        {
+            try
+            {
+                fWriter.reset();
+            }
+            catch(const RException& e)
+            {
+                cerr << "Error writing RNTuple lyso_est: " << e.what() << endl;
+                return false;
+            }
+            return true;
+        }
+
+      private:
+        OutputTier fTier;
+        unique_ptr<RNT::RNTupleParallelWriter> fWriter;
+    };
+#endif // ANALYZER_RNTUPLE
+}
+
+
+
+unique_ptr<OutputFileLYSO> OutputFileLYSO::Create(OutputFormat format, OutputTier tier, const string& filename, Bool_t isShared)
+{
+    if(format == OutputFormat::TTree)
+    {
+        if(isShared)
+            return make_unique<MergerTreeFile>(tier, filename);
+
+        unique_ptr<TFile> file(TFile::Open(filename.c_str(), "RECREATE"));
+        if(!file || file->IsZombie())
+        {
+            cerr << "Error opening file: " << filename << endl;
+            return nullptr;
+        }
+        return make_unique<TreeFile>(tier, move(file));
+    }
+
+#ifdef ANALYZER_RNTUPLE
+    try
+    {
+        if(isShared)
+            return make_unique<ParallelNTupleFile>(tier, RNT::RNTupleParallelWriter::Recreate(CreateModel(tier), "lyso_est", filename));
+        return make_unique<NTupleFile>(tier, RNT::RNTupleWriter::Recreate(CreateModel(tier), "lyso_est", filename));
+    }
+    catch(const RException& e)
+    {
+        cerr << "Error opening file: " << filename << " (" << e.what() << ")" << endl;
+        return nullptr;
+    }
+#else
+    cerr << "RNTuple output not available: ROOT built without ROOTNTuple" << endl;
+    return nullptr;
+#endif
+}
@@ -0,0 +1,198 @@
+#include "readaheadlyso.hh"
+#include "eventlyso.hh"
+
+#include <chrono>
+
+using namespace std;
+using namespace ROOT;
+
+
+namespace
+{
+    // A few clusters of ~1 MB entries
+    constexpr Long64_t cacheSize = 64 << 20;
+
+    Double_t SecondsSince(chrono::steady_clock::time_point start)
+    {
+        return chrono::duration<Double_t>(chrono::steady_clock::now() - start).count();
+    }
+}
+
+
+
+ReadAheadStats& ReadAheadStats::operator+=(const ReadAheadStats& other)
+{
+    read += other.read;
+    readerStall += other.readerStall;
+    consumerStall += other.consumerStall;
+    return *this;
+}
+
+
+
+ReadAheadLYSO::ReadAheadLYSO(const char* barFilename, shared_ptr<TimeCalibrationLYSO> calibration, Long64_t first, Long64_t last,
+                             Int_t queueSize, Int_t nReaders, MetricsLYSO* metrics)
+    : fFirst(first), fLast(last), fQueueSize(queueSize > 0 ? queueSize : 0), fNext(first), fMetrics(metrics)
+{
+    Int_t nInputs = fQueueSize > 0 ? TMath::Max(nReaders, 1) : 1;
+    for(Int_t r = 0; r < nInputs; r++)
+    {
+        fInputs.push_back(make_unique<InputLYSO>(barFilename, calibration));
+        if(!fInputs.back()->IsValid())
+        {
+            isValid = false;
+            return;
+        }
+        // Readers take the clusters in turn: the next cluster of the tree
+        // belongs to another reader, prefetching it would be wasted I/O
+        fInputs.back()->SetCache(first, last, cacheSize, nInputs == 1);
+    }
+
+    if(fQueueSize == 0)
+        return;
+
+    fReady.resize(fQueueSize);
+    fClusters = fInputs[0]->GetClusters(first, last);
+    for(Int_t r = 0; r < nInputs; r++)
+        fReaders.emplace_back(&ReadAheadLYSO::ReadLoop, this, r);
+}
+
+
+
+ReadAheadLYSO::~ReadAheadLYSO()
+{
+    {
+        lock_guard<mutex> lock(fMutex);
+        isStopping = true;
+    }
+    fRoomCV.notify_all();
+
+    for(auto& r : fReaders)
+        r.join();
+}
+
+
+
+Bool_t ReadAheadLYSO::Pop(unique_ptr<DecodedEventLYSO>& event)
+{
+    if(fNext >= fLast)
+        return false;
+
+    // Synchronous
+    if(fQueueSize == 0)
+    {
+        // Read by the consumer: its counters
+        if(fMetrics && !fSyncStats)
+            fSyncStats = fMetrics->GetThread("analysis");
+        event = TakeFree();
+        auto start = chrono::steady_clock::now();
+        Read(*fInputs[0], fNext++, *event, fSyncStats);
+        fStats.read += SecondsSince(start);
+        return true;
+    }
+
+    unique_lock<mutex> lock(fMutex);
+
+    auto start = chrono::steady_clock::now();
+    // fNext may move while waiting: other consumers
+    auto slot = [this]() -> unique_ptr<DecodedEventLYSO>& { return fReady[(fNext - fFirst) % fQueueSize]; };
+    fDataCV.wait(lock, [&slot] { return slot() != nullptr; });
+    fStats.consumerStall += SecondsSince(start);
+
+    event = move(slot());
+    fNext++;
+
+    // The window moved forward
+    lock.unlock();
+    fRoomCV.notify_all();
+
+    return true;
+}
+
+
+
+void ReadAheadLYSO::Recycle(unique_ptr<DecodedEventLYSO> event)
+{
+    // Buffers taken over by an EventLYSO and not given back are reallocated
+    if(event->samples.size() != FACES*CHANNELS*SAMPLINGS)
+        return;
+
+    lock_guard<mutex> lock(fMutex);
+    fFree.push_back(move(event));
+}
+
+
+
+ReadAheadStats ReadAheadLYSO::GetStats()
+{
+    lock_guard<mutex> lock(fMutex);
+    return fStats;
+}
+
+
+
+void ReadAheadLYSO::ReadLoop(Int_t reader)
+{
+    InputLYSO& input = *fInputs[reader];
+    Int_t nReaders = fInputs.size();
+    MetricsThreadLYSO* stats = fMetrics ? fMetrics->GetThread("reader") : nullptr;
+
+    for(size_t c = reader; c < fClusters.size(); c += nReaders)
+    {
+        for(Long64_t k = fClusters[c].first; k < fClusters[c].second; k++)
+        {
+            unique_ptr<DecodedEventLYSO> event;
+            {
+                unique_lock<mutex> lock(fMutex);
+
+                // The entry fNext is always inside the window: no deadlock
+                auto start = chrono::steady_clock::now();
+                fRoomCV.wait(lock, [this, k] { return isStopping || k < fNext + fQueueSize; });
+                fStats.readerStall += SecondsSince(start);
+                if(isStopping)
+                    return;
+
+                event = TakeFree();
+            }
+
+            auto start = chrono::steady_clock::now();
+            Read(input, k, *event, stats);
+            Double_t elapsed = SecondsSince(start);
+
+            {
+                lock_guard<mutex> lock(fMutex);
+                fStats.read += elapsed;
+                fReady[(k - fFirst) % fQueueSize] = move(event);
+            }
+            fDataCV.notify_one();
+        }
+    }
+}
+
+
+
+void ReadAheadLYSO::Read(InputLYSO& input, Long64_t k, DecodedEventLYSO& event, MetricsThreadLYSO* stats)
+{
+    StageTimerLYSO timer(stats);
+    input.GetEntry(k);
+    timer.Lap(StageLYSO::GetEntry);
+
+    event.entry = k;
+    event.event = input.GetEvent();
+    copy_n(input.GetTimeGrids(), FACES*CHANNELS, event.times);
+    EventLYSO::PackSamples(input.GetFront(), input.GetBack(), event.samples.data());
+    timer.Lap(StageLYSO::Pack);
+}
+
+
+
+unique_ptr<DecodedEventLYSO> ReadAheadLYSO::TakeFree()
+{
+    // At most queueSize + 1 buffers: the window and the event under analysis
+    if(fFree.empty())
+        return make_unique<DecodedEventLYSO>();
+
+    auto event = move(fFree.back());
+    fFree.pop_back();
+    return event;
+}
@@ -0,0 +1,264 @@
+#include "scanlyso.hh"
+#include "shardlyso.hh"
+
+#include <memory>
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+#include <cmath>
+
+#include <TFile.h>
+#include <TNamed.h>
+
+using namespace std;
+
+
+ParametersLYSO ParametersLYSO::FromConfig()
+{
+    ParametersLYSO p;
+    p.mppc = ParametersMPPC::FromConfig();
+    p.nCircles_Time = ConfigAnalyzer::GetInstance()->nCircles_Time;
+    p.nCircles_Position = ConfigAnalyzer::GetInstance()->nCircles_Position;
+
+    return p;
+}
+
+
+
+Bool_t ParametersLYSO::Set(const string& name, const string& value)
+{
+    // Same conversions as ConfigAnalyzer::LoadConfig
+    if(name == "trgLevel")
+        mppc.trgLevel = stof(value);
+    else if(name == "lowBase")
+        mppc.lowBase = stoi(value);
+    else if(name == "upBase")
+        mppc.upBase = stoi(value);
+    else if(name == "lowInt")
+        mppc.lowInt = stoi(value);
+    else if(name == "upInt")
+        mppc.upInt = stoi(value);
+    else if(name == "nCircles_Time")
+        nCircles_Time = stoi(value);
+    else if(name == "nCircles_Position")
+        nCircles_Position = stoi(value);
+    else
+        return false;
+
+    return true;
+}
+
+
+
+string ParametersLYSO::ToString() const
+{
+    ostringstream text;
+    text.precision(9);
+    text << "trgLevel = " << mppc.trgLevel << endl;
+    text << "lowBase = " << mppc.lowBase << endl;
+    text << "upBase = " << mppc.upBase << endl;
+    text << "lowInt = " << mppc.lowInt << endl;
+    text << "upInt = " << mppc.upInt << endl;
+    text << "nCircles_Time = " << nCircles_Time << endl;
+    text << "nCircles_Position = " << nCircles_Position << endl;
+
+    return text.str();
+}
+
+
+
+ScanLYSO::ScanLYSO(vector<ParametersLYSO> points) : fPoints(move(points)), fOrder(fPoints.size())
+{
+    iota(fOrder.begin(), fOrder.end(), 0);
+    stable_sort(fOrder.begin(), fOrder.end(), [this](Int_t a, Int_t b)
+    {
+        const ParametersMPPC& pa = fPoints[a].mppc;
+        const ParametersMPPC& pb = fPoints[b].mppc;
+        return make_tuple(pa.lowBase, pa.upBase, pa.lowInt, pa.upInt, pa.trgLevel)
+             < make_tuple(pb.lowBase, pb.upBase, pb.lowInt, pb.upInt, pb.trgLevel);
+    });
+}
+
+
+
+Bool_t ScanLYSO::Parse(const char* filename, const ParametersLYSO& base, vector<ParametersLYSO>& points)
+{
+    ifstream file(filename);
+    if(!file.is_open())
+    {
+        cerr << "Error opening file: " << filename << endl;
+        return false;
+    }
+
+    // Values of every parameter of the current grid, in file order
+    vector<pair<string, vector<string>>> grid;
+
+    auto addGrid = [&grid, &base, &points]()
+    {
+        vector<size_t> index(grid.size(), 0);
+        while(true)
+        {
+            ParametersLYSO p = base;
+            for(size_t i = 0; i < grid.size(); i++)
+                p.Set(grid[i].first, grid[i].second[index[i]]);
+            points.push_back(p);
+
+            // Next combination, the last parameter runs fastest
+            Int_t i = grid.size() - 1;
+            for(; i >= 0; i--)
+            {
+                if(++index[i] < grid[i].second.size())
+                    break;
+                index[i] = 0;
+            }
+            if(i < 0)
+                break;
+        }
+        grid.clear();
+    };
+
+    string line;
+    Bool_t isEmptyGrid = true;
+    while(getline(file, line))
+    {
+        line = regex_replace(line, regex("^\\s+|\\s+$"), "");
+        if(line == "---")
+        {
+            if(!isEmptyGrid)
+                addGrid();
+            isEmptyGrid = true;
+            continue;
+        }
+        if(line.empty() || line[0] == '#')
+            continue;
+
+        size_t equalPos = line.find('=');
+        if(equalPos == string::npos)
+            continue;
+
+        string name = regex_replace(line.substr(0, equalPos), regex("^\\s+|\\s+$"), "");
+        vector<string> values;
+        istringstream list(line.substr(equalPos + 1));
+        string item;
+        while(getline(list, item, ','))
+        {
+            item = regex_replace(item, regex("^\\s+|\\s+$"), "");
+            if(item.empty())
+                continue;
+
+            // Range start:stop:step
+            size_t colon1 = item.find(':');
+            if(colon1 == string::npos)
+            {
+                values.push_back(item);
+                continue;
+            }
+            size_t colon2 = item.find(':', colon1 + 1);
+            if(colon2 == string::npos)
+            {
+                cerr << "Range not valid, expected start:stop:step: " << item << endl;
+                return false;
+            }
+            Double_t start = stod(item.substr(0, colon1));
+            Double_t stop = stod(item.substr(colon1 + 1, colon2 - colon1 - 1));
+            Double_t step = stod(item.substr(colon2 + 1));
+            if(step == 0 || (stop - start)/step < 0)
+            {
+                cerr << "Range not valid: " << item << endl;
+                return false;
+            }
+            Int_t n = floor((stop - start)/step + 1e-9) + 1;
+            for(Int_t i = 0; i < n; i++)
+            {
+                ostringstream value;
+                value.precision(9);
+                value << start + i*step;
+                values.push_back(value.str());
+            }
+        }
+
+        ParametersLYSO check;
+        if(values.empty() || !check.Set(name, values[0]))
+        {
+            cerr << "Parameter not valid in a scan: " << line << endl;
+            return false;
+        }
+        grid.emplace_back(name, values);
+        isEmptyGrid = false;
+    }
+    if(!isEmptyGrid)
+        addGrid();
+
+    for(const auto& p : points)
+    {
+        const ParametersMPPC& par = p.mppc;
+        if(par.lowBase < 0 || par.lowBase >= par.upBase || par.upBase >= SAMPLINGS || par.lowInt < 0 || par.lowInt >= par.upInt || par.upInt >= SAMPLINGS)
+        {
+            cerr << "Limits not valid in the scan point:" << endl << p.ToString();
+            return false;
+        }
+    }
+
+    return !points.empty();
+}
+
+
+
+string ScanLYSO::GetFilename(const string& outputFilename, Int_t k) const
+{
+    string index = to_string(k);
+    string width = to_string(GetSize() - 1);
+    if(index.size() < width.size())
+        index.insert(0, width.size() - index.size(), '0');
+
+    return ShardFilename(outputFilename, "scan" + index);
+}
+
+
+
+Bool_t ScanLYSO::WriteConfig(const string& filename, Int_t k) const
+{
+    unique_ptr<TFile> file(TFile::Open(filename.c_str(), "UPDATE"));
+    if(!file || file->IsZombie())
+    {
+        cerr << "Error opening file: " << filename << endl;
+        return false;
+    }
+
+    TNamed config("lyso_config", fPoints[k].ToString().c_str());
+    file->WriteTObject(&config);
+
+    return true;
+}
+
+
+
+void ScanLYSO::Print() const
+{
+    cout << "AnalyzerWT>> Scan of " << GetSize() << " configurations:" << endl;
+    for(Int_t k = 0; k < GetSize(); k++)
+    {
+        const ParametersLYSO& p = fPoints[k];
+        cout << "AnalyzerWT>>   " << k << ": trgLevel " << p.mppc.trgLevel
+             << ", base [" << p.mppc.lowBase << ", " << p.mppc.upBase << "]"
+             << ", int [" << p.mppc.lowInt << ", " << p.mppc.upInt << "]"
+             << ", nCircles_Time " << p.nCircles_Time << ", nCircles_Position " << p.nCircles_Position << endl;
+    }
+}
+
+
+
+Bool_t ScanLYSO::IsSameBaseline(const ParametersMPPC& a, const ParametersMPPC& b)
+{
+    return a.lowBase == b.lowBase && a.upBase == b.upBase;
+}
+
+
+
+Bool_t ScanLYSO::IsSameWindows(const ParametersMPPC& a, const ParametersMPPC& b)
+{
+    if(a.lowBase != b.lowBase || a.upBase != b.upBase || a.lowInt != b.lowInt || a.upInt != b.upInt || a.nFractions != b.nFractions)
+        return false;
+
+    return equal(a.fractions, a.fractions + a.nFractions, b.fractions);
+}
@@ -0,0 +1,189 @@
+#include "shardlyso.hh"
+
+#include <memory>
+#include <algorithm>
+
+#include <TFile.h>
+#include <TParameter.h>
+#include <TNamed.h>
+#include <TFileMerger.h>
+
+using namespace std;
+
+
+string ShardFilename(const string& outputFilename, const string& tag)
+{
+    string stem = outputFilename;
+    if(stem.size() > 5 && stem.compare(stem.size() - 5, 5, ".root") == 0)
+        stem.resize(stem.size() - 5);
+
+    return stem + "_" + tag + ".root";
+}
+
+
+
+string ShardTag(Int_t shard, Int_t nShards)
+{
+    string index = to_string(shard);
+    string width = to_string(nShards - 1);
+    if(index.size() < width.size())
+        index.insert(0, width.size() - index.size(), '0');
+
+    return "shard" + index + "of" + to_string(nShards);
+}
+
+
+
+string EntryRangeTag(Long64_t first, Long64_t last)
+{
+    return "entries" + to_string(first) + "to" + (last < 0 ? string("end") : to_string(last));
+}
+
+
+
+Bool_t WriteShardInfo(const string& filename, const ShardInfo& info)
+{
+    unique_ptr<TFile> file(TFile::Open(filename.c_str(), "UPDATE"));
+    if(!file || file->IsZombie())
+    {
+        cerr << "Error opening file: " << filename << endl;
+        return false;
+    }
+
+    TParameter<Long64_t> first("lyso_shard_first", info.first);
+    TParameter<Long64_t> last("lyso_shard_last", info.last);
+    TParameter<Long64_t> total("lyso_shard_total", info.total);
+    TNamed input("lyso_shard_input", info.input.c_str());
+    file->WriteTObject(&first);
+    file->WriteTObject(&last);
+    file->WriteTObject(&total);
+    file->WriteTObject(&input);
+
+    return true;
+}
+
+
+
+Bool_t ReadShardInfo(const string& filename, ShardInfo& info)
+{
+    unique_ptr<TFile> file(TFile::Open(filename.c_str(), "READ"));
+    if(!file || file->IsZombie())
+        return false;
+
+    unique_ptr<TParameter<Long64_t>> first(file->Get<TParameter<Long64_t>>("lyso_shard_first"));
+    unique_ptr<TParameter<Long64_t>> last(file->Get<TParameter<Long64_t>>("lyso_shard_last"));
+    unique_ptr<TParameter<Long64_t>> total(file->Get<TParameter<Long64_t>>("lyso_shard_total"));
+    unique_ptr<TNamed> input(file->Get<TNamed>("lyso_shard_input"));
+    if(!first || !last || !total || !input)
+        return false;
+
+    info.first = first->GetVal();
+    info.last = last->GetVal();
+    info.total = total->GetVal();
+    info.input = input->GetTitle();
+
+    return true;
+}
+
+
+
+Bool_t ConcatenateOutputs(const string& outputFilename, const vector<string>& filenames, const vector<string>& treeNames)
+{
+    // Fast merging of the trees only: the shard info can't be summed
+    TFileMerger merger(false, false);
+    merger.SetFastMethod(true);
+    if(!merger.OutputFile(outputFilename.c_str(), "RECREATE"))
+        return false;
+    for(const auto& f : filenames)
+    {
+        if(!merger.AddFile(f.c_str(), false))
+            return false;
+    }
+    for(const auto& name : treeNames)
+        merger.AddObjectNames(name.c_str());
+    if(!merger.PartialMerge(TFileMerger::kAll | TFileMerger::kRegular | TFileMerger::kOnlyListed))
+    {
+        cerr << "Error merging into: " << outputFilename << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+
+Bool_t MergeShards(const string& outputFilename, vector<string> shardFilenames, Bool_t isForced)
+{
+    // Entry order
+    vector<pair<ShardInfo, string>> shards;
+    Bool_t hasInfo = true;
+    for(const auto& f : shardFilenames)
+    {
+        ShardInfo info;
+        if(!ReadShardInfo(f, info))
+        {
+            cerr << "No shard info in " << f << endl;
+            hasInfo = false;
+        }
+        shards.emplace_back(info, f);
+    }
+
+    // One contiguous range of one input: anything else would duplicate or
+    // lose events, or mix different bar files
+    Bool_t isContiguous = hasInfo;
+    if(!hasInfo && !isForced)
+    {
+        cerr << "Shards not merged: their order and inputs can't be checked" << endl;
+        return false;
+    }
+    if(hasInfo)
+    {
+        stable_sort(shards.begin(), shards.end(), [](const auto& a, const auto& b) { return a.first.first < b.first.first; });
+
+        for(size_t i = 1; i < shards.size(); i++)
+        {
+            const ShardInfo& previous = shards[i-1].first;
+            const ShardInfo& current = shards[i].first;
+            if(current.input != previous.input)
+            {
+                cerr << "Shards of different inputs: " << shards[i-1].second << " from " << previous.input
+                     << ", " << shards[i].second << " from " << current.input << endl;
+                isContiguous = false;
+            }
+            else if(current.total != previous.total)
+            {
+                cerr << "Shards of different inputs: " << shards[i-1].second << " has " << previous.total
+                     << " entries, " << shards[i].second << " has " << current.total << endl;
+                isContiguous = false;
+            }
+            if(current.first != previous.last)
+            {
+                cerr << (current.first < previous.last ? "Shards overlapping: " : "Shards not contiguous: ")
+                     << shards[i-1].second << " ends at " << previous.last
+                     << ", " << shards[i].second << " starts at " << current.first << endl;
+                isContiguous = false;
+            }
+        }
+
+        if(!isContiguous && !isForced)
+        {
+            cerr << "Shards not merged" << endl;
+            return false;
+        }
+    }
+
+    vector<string> ordered;
+    for(const auto& s : shards)
+        ordered.push_back(s.second);
+    if(!ConcatenateOutputs(outputFilename, ordered))
+        return false;
+
+    // A forced merge of gaps, overlaps or different inputs is not a range
+    if(isContiguous && !shards.empty())
+    {
+        ShardInfo merged{shards.front().first.first, shards.back().first.last, shards.front().first.total, shards.front().first.input};
+        return WriteShardInfo(outputFilename, merged);
+    }
+
+    return true;
+}
@@ -0,0 +1,671 @@
+#include "simdmppc.hh"
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SIMDMPPC_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+
+namespace
+{
+    SimdLevel DetectSimdLevel()
+    {
+#ifdef SIMDMPPC_X86
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx512f"))
+            return SimdLevel::AVX512;
+        if(__builtin_cpu_supports("avx2"))
+            return SimdLevel::AVX2;
+        if(__builtin_cpu_supports("sse4.2"))
+            return SimdLevel::SSE42;
+#endif
+        return SimdLevel::Scalar;
+    }
+
+
+    SimdLevel InitialSimdLevel()
+    {
+        SimdLevel level = DetectSimdLevel();
+
+        const char* env = getenv("ANALYZER_SIMD");
+        if(env)
+        {
+            SimdLevel requested = level;
+            if(!ParseSimdLevel(env, requested))
+                cerr << "Unknown ANALYZER_SIMD value: " << env << endl;
+
+            level = min(requested, level);
+        }
+
+        return level;
+    }
+
+
+    atomic<SimdLevel>& CurrentSimdLevel()
+    {
+        static atomic<SimdLevel> level{InitialSimdLevel()};
+        return level;
+    }
+
+
+    // Per-lane results of sweeps 1-2, same finalization as the scalar kernel
+    template<typename Shape>
+    inline void SetBaselines(const Double_t* sum, const Double_t* sumSquares, Int_t lanes, const Shape& shape, EstimatorsMPPC* est)
+    {
+        for(Int_t l = 0; l < lanes; l++)
+            SetBaselineMPPC(sum[l], sumSquares[l], shape, est[l]);
+    }
+
+    inline void SetChargesAmplitudes(const Double_t* charge, const Double_t* amplitude, Int_t lanes, const ParametersMPPC& par, EstimatorsMPPC* est)
+    {
+        for(Int_t l = 0; l < lanes; l++)
+        {
+            est[l].charge = charge[l];
+            est[l].amplitude = amplitude[l];
+            est[l].trigger = amplitude[l] > -par.trgLevel;
+        }
+    }
+
+
+    // Shape: DynamicShapeMPPC or DefaultShapeMPPC, as the scalar kernel
+    template<typename Shape>
+    void WindowsScalar(const Float_t* const* t, const Float_t* const* w, Int_t n, const ParametersMPPC& par, const Shape& shape, EstimatorsMPPC* est)
+    {
+        for(Int_t c = 0; c < n; c++)
+            MeasureWindowsMPPC(t[c], w[c], par, shape, est[c]);
+    }
+
+
+#ifdef SIMDMPPC_X86
+    // Every lane performs the same double operations as the scalar kernel.
+    // Contraction into FMA is harmless: x*x of a float and the final *0.5 of
+    // the trapezoid are exact, so fused and unfused results round the same
+
+    template<typename Shape>
+    __attribute__((target("sse4.2")))
+    void WindowsSSE42(const Float_t* const* t, const Float_t* const* w, Int_t n, const ParametersMPPC& par, const Shape& shape, EstimatorsMPPC* est)
+    {
+        constexpr Int_t lanes = 2;
+        alignas(16) Double_t a[lanes], b[lanes];
+
+        Int_t c = 0;
+        for(; c + lanes <= n; c += lanes)
+        {
+            const Float_t *w0 = w[c], *w1 = w[c+1];
+            const Float_t *t0 = t[c], *t1 = t[c+1];
+
+            __m128d sum = _mm_setzero_pd(), sumSquares = _mm_setzero_pd();
+            for(Int_t i = shape.LowBase(); i <= shape.UpBase(); i++)
+            {
+                __m128d x = _mm_set_pd(w1[i], w0[i]);
+                sum = _mm_add_pd(sum, x);
+                sumSquares = _mm_add_pd(sumSquares, _mm_mul_pd(x, x));
+            }
+            _mm_store_pd(a, sum);
+            _mm_store_pd(b, sumSquares);
+            SetBaselines(a, b, lanes, shape, est + c);
+
+            const __m128d base = _mm_set_pd(est[c+1].baseline, est[c].baseline);
+            const __m128d twoBase = _mm_mul_pd(_mm_set1_pd(2), base);
+            const __m128d half = _mm_set1_pd(0.5);
+
+            __m128d xPrev = _mm_set_pd(w1[shape.LowInt()], w0[shape.LowInt()]);
+            __m128d tPrev = _mm_set_pd(t1[shape.LowInt()], t0[shape.LowInt()]);
+            __m128d charge = _mm_setzero_pd();
+            __m128d amplitude = _mm_sub_pd(base, xPrev);
+            for(Int_t i = shape.LowInt(); i < shape.UpInt(); i++)
+            {
+                __m128d x = _mm_set_pd(w1[i+1], w0[i+1]);
+                __m128d tt = _mm_set_pd(t1[i+1], t0[i+1]);
+                charge = _mm_add_pd(charge, _mm_mul_pd(_mm_mul_pd(_mm_sub_pd(twoBase, _mm_add_pd(xPrev, x)), _mm_sub_pd(tt, tPrev)), half));
+                amplitude = _mm_max_pd(amplitude, _mm_sub_pd(base, x));
+                xPrev = x;
+                tPrev = tt;
+            }
+            _mm_store_pd(a, charge);
+            _mm_store_pd(b, amplitude);
+            SetChargesAmplitudes(a, b, lanes, par, est + c);
+        }
+
+        WindowsScalar(t + c, w + c, n - c, par, shape, est + c);
+    }
+
+
+    // Byte offsets of lanes' buffers from the first one, for the gathers
+    __attribute__((target("avx2")))
+    inline __m256i LaneOffsets4(const Float_t* const* p)
+    {
+        auto base = reinterpret_cast<intptr_t>(p[0]);
+        return _mm256_set_epi64x(reinterpret_cast<intptr_t>(p[3]) - base, reinterpret_cast<intptr_t>(p[2]) - base,
+                                 reinterpret_cast<intptr_t>(p[1]) - base, 0);
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256d Gather4(const Float_t* base, __m256i offsets, Int_t i)
+    {
+        return _mm256_cvtps_pd(_mm256_i64gather_ps(base + i, offsets, 1));
+    }
+
+    template<typename Shape>
+    __attribute__((target("avx2")))
+    void WindowsAVX2(const Float_t* const* t, const Float_t* const* w, Int_t n, const ParametersMPPC& par, const Shape& shape, EstimatorsMPPC* est)
+    {
+        constexpr Int_t lanes = 4;
+        alignas(32) Double_t a[lanes], b[lanes];
+
+        Int_t c = 0;
+        for(; c + lanes <= n; c += lanes)
+        {
+            const Float_t *w0 = w[c], *t0 = t[c];
+            const __m256i wOff = LaneOffsets4(w + c);
+            const __m256i tOff = LaneOffsets4(t + c);
+
+            __m256d sum = _mm256_setzero_pd(), sumSquares = _mm256_setzero_pd();
+            for(Int_t i = shape.LowBase(); i <= shape.UpBase(); i++)
+            {
+                __m256d x = Gather4(w0, wOff, i);
+                sum = _mm256_add_pd(sum, x);
+                sumSquares = _mm256_add_pd(sumSquares, _mm256_mul_pd(x, x));
+            }
+            _mm256_store_pd(a, sum);
+            _mm256_store_pd(b, sumSquares);
+            SetBaselines(a, b, lanes, shape, est + c);
+
+            const __m256d base = _mm256_set_pd(est[c+3].baseline, est[c+2].baseline, est[c+1].baseline, est[c].baseline);
+            const __m256d twoBase = _mm256_mul_pd(_mm256_set1_pd(2), base);
+            const __m256d half = _mm256_set1_pd(0.5);
+
+            __m256d xPrev = Gather4(w0, wOff, shape.LowInt());
+            __m256d tPrev = Gather4(t0, tOff, shape.LowInt());
+            __m256d charge = _mm256_setzero_pd();
+            __m256d amplitude = _mm256_sub_pd(base, xPrev);
+            for(Int_t i = shape.LowInt(); i < shape.UpInt(); i++)
+            {
+                __m256d x = Gather4(w0, wOff, i + 1);
+                __m256d tt = Gather4(t0, tOff, i + 1);
+                charge = _mm256_add_pd(charge, _mm256_mul_pd(_mm256_mul_pd(_mm256_sub_pd(twoBase, _mm256_add_pd(xPrev, x)), _mm256_sub_pd(tt, tPrev)), half));
+                amplitude = _mm256_max_pd(amplitude, _mm256_sub_pd(base, x));
+                xPrev = x;
+                tPrev = tt;
+            }
+            _mm256_store_pd(a, charge);
+            _mm256_store_pd(b, amplitude);
+            SetChargesAmplitudes(a, b, lanes, par, est + c);
+        }
+
+        WindowsSSE42(t + c, w + c, n - c, par, shape, est + c);
+    }
+
+
+    __attribute__((target("avx512f")))
+    inline __m512i LaneOffsets8(const Float_t* const* p)
+    {
+        auto base = reinterpret_cast<intptr_t>(p[0]);
+        return _mm512_set_epi64(reinterpret_cast<intptr_t>(p[7]) - base, reinterpret_cast<intptr_t>(p[6]) - base,
+                                reinterpret_cast<intptr_t>(p[5]) - base, reinterpret_cast<intptr_t>(p[4]) - base,
+                                reinterpret_cast<intptr_t>(p[3]) - base, reinterpret_cast<intptr_t>(p[2]) - base,
+                                reinterpret_cast<intptr_t>(p[1]) - base, 0);
+    }
+
+    __attribute__((target("avx512f")))
+    inline __m512d Gather8(const Float_t* base, __m512i offsets, Int_t i)
+    {
+        return _mm512_cvtps_pd(_mm512_i64gather_ps(offsets, base + i, 1));
+    }
+
+    template<typename Shape>
+    __attribute__((target("avx512f")))
+    void WindowsAVX512(const Float_t* const* t, const Float_t* const* w, Int_t n, const ParametersMPPC& par, const Shape& shape, EstimatorsMPPC* est)
+    {
+        constexpr Int_t lanes = 8;
+        alignas(64) Double_t a[lanes], b[lanes];
+
+        Int_t c = 0;
+        for(; c + lanes <= n; c += lanes)
+        {
+            const Float_t *w0 = w[c], *t0 = t[c];
+            const __m512i wOff = LaneOffsets8(w + c);
+            const __m512i tOff = LaneOffsets8(t + c);
+
+            __m512d sum = _mm512_setzero_pd(), sumSquares = _mm512_setzero_pd();
+            for(Int_t i = shape.LowBase(); i <= shape.UpBase(); i++)
+            {
+                __m512d x = Gather8(w0, wOff, i);
+                sum = _mm512_add_pd(sum, x);
+                sumSquares = _mm512_add_pd(sumSquares, _mm512_mul_pd(x, x));
+            }
+            _mm512_store_pd(a, sum);
+            _mm512_store_pd(b, sumSquares);
+            SetBaselines(a, b, lanes, shape, est + c);
+
+            const __m512d base = _mm512_set_pd(est[c+7].baseline, est[c+6].baseline, est[c+5].baseline, est[c+4].baseline,
+                                               est[c+3].baseline, est[c+2].baseline, est[c+1].baseline, est[c].baseline);
+            const __m512d twoBase = _mm512_mul_pd(_mm512_set1_pd(2), base);
+            const __m512d half = _mm512_set1_pd(0.5);
+
+            __m512d xPrev = Gather8(w0, wOff, shape.LowInt());
+            __m512d tPrev = Gather8(t0, tOff, shape.LowInt());
+            __m512d charge = _mm512_setzero_pd();
+            __m512d amplitude = _mm512_sub_pd(base, xPrev);
+            for(Int_t i = shape.LowInt(); i < shape.UpInt(); i++)
+            {
+                __m512d x = Gather8(w0, wOff, i + 1);
+                __m512d tt = Gather8(t0, tOff, i + 1);
+                charge = _mm512_add_pd(charge, _mm512_mul_pd(_mm512_mul_pd(_mm512_sub_pd(twoBase, _mm512_add_pd(xPrev, x)), _mm512_sub_pd(tt, tPrev)), half));
+                amplitude = _mm512_max_pd(amplitude, _mm512_sub_pd(base, x));
+                xPrev = x;
+                tPrev = tt;
+            }
+            _mm512_store_pd(a, charge);
+            _mm512_store_pd(b, amplitude);
+            SetChargesAmplitudes(a, b, lanes, par, est + c);
+        }
+
+        WindowsAVX2(t + c, w + c, n - c, par, shape, est + c);
+    }
+#endif
+
+
+    template<typename Shape>
+    void WindowsDispatch(const Float_t* const* t, const Float_t* const* w, Int_t n, const ParametersMPPC& par, const Shape& shape, EstimatorsMPPC* est)
+    {
+        switch(GetSimdLevel())
+        {
+#ifdef SIMDMPPC_X86
+            case SimdLevel::AVX512:
+                WindowsAVX512(t, w, n, par, shape, est);
+                break;
+            case SimdLevel::AVX2:
+                WindowsAVX2(t, w, n, par, shape, est);
+                break;
+            case SimdLevel::SSE42:
+                WindowsSSE42(t, w, n, par, shape, est);
+                break;
+#endif
+            case SimdLevel::Scalar:
+            default:
+                WindowsScalar(t, w, n, par, shape, est);
+                break;
+        }
+    }
+
+
+    // Crossing search. A float sample compares with a double value as with
+    // its float rounding towards the inside of the accepted region, so that
+    // blocks of samples can be compared in single precision
+
+    inline Float_t FloatThreshold(Double_t value, Bool_t isGreaterOrLesser)
+    {
+        Float_t v = value;
+        if(isGreaterOrLesser && Double_t(v) < value)
+            v = nextafter(v, HUGE_VALF);
+        else if(!isGreaterOrLesser && Double_t(v) > value)
+            v = nextafter(v, -HUGE_VALF);
+        return v;
+    }
+
+    template<Bool_t isGreaterOrLesser, typename T, typename V>
+    inline Bool_t Crosses(T sample, V value)
+    {
+        return isGreaterOrLesser ? sample >= value : sample <= value;
+    }
+
+    template<Bool_t isGreaterOrLesser, typename T, typename V>
+    Int_t CrossingScalar(const T* w, V value, Int_t binStart, Int_t binEnd)
+    {
+        if(binStart <= binEnd)
+        {
+            for(Int_t i = binStart; i <= binEnd; i++)
+                if(Crosses<isGreaterOrLesser>(w[i], value))
+                    return i;
+        }
+        else
+        {
+            for(Int_t i = binStart; i >= binEnd; i--)
+                if(Crosses<isGreaterOrLesser>(w[i], value))
+                    return i;
+        }
+        return -1;
+    }
+
+    // Scalar search of the bins left after the blocks, in the original direction
+    template<Bool_t isGreaterOrLesser, typename T, typename V>
+    Int_t CrossingTail(const T* w, V value, Int_t binStart, Int_t i, Int_t binEnd)
+    {
+        if(binStart <= binEnd ? i > binEnd : i < binEnd)
+            return -1;
+        return CrossingScalar<isGreaterOrLesser>(w, value, i, binEnd);
+    }
+
+    template<typename T, typename V>
+    void CrossingsScalar(const T* w, const V* values, Int_t n, Int_t binStart, Int_t binEnd, Int_t* bins)
+    {
+        Int_t nMissing = n;
+        for(Int_t i = binStart; i <= binEnd && nMissing > 0; i++)
+        {
+            for(Int_t j = 0; j < n; j++)
+            {
+                if(bins[j] < 0 && w[i] <= values[j])
+                {
+                    bins[j] = i;
+                    nMissing--;
+                }
+            }
+        }
+    }
+
+
+#ifdef SIMDMPPC_X86
+    template<Bool_t isGreaterOrLesser>
+    __attribute__((target("sse4.2")))
+    inline Int_t Mask4(__m128 x, __m128 v)
+    {
+        return _mm_movemask_ps(isGreaterOrLesser ? _mm_cmpge_ps(x, v) : _mm_cmple_ps(x, v));
+    }
+
+    template<Bool_t isGreaterOrLesser>
+    __attribute__((target("sse4.2")))
+    Int_t CrossingSSE42(const Float_t* w, Float_t value, Int_t binStart, Int_t binEnd)
+    {
+        const __m128 v = _mm_set1_ps(value);
+        Int_t i = binStart;
+        if(binStart <= binEnd)
+        {
+            for(; i + 3 <= binEnd; i += 4)
+                if(Int_t mask = Mask4<isGreaterOrLesser>(_mm_loadu_ps(w + i), v))
+                    return i + __builtin_ctz(mask);
+        }
+        else
+        {
+            for(; i - 3 >= binEnd; i -= 4)
+                if(Int_t mask = Mask4<isGreaterOrLesser>(_mm_loadu_ps(w + i - 3), v))
+                    return i - 3 + (31 - __builtin_clz(mask));
+        }
+        return CrossingTail<isGreaterOrLesser>(w, value, binStart, i, binEnd);
+    }
+
+    __attribute__((target("sse4.2")))
+    void CrossingsSSE42(const Float_t* w, const Float_t* values, Int_t n, Int_t binStart, Int_t binEnd, Int_t* bins)
+    {
+        Int_t nMissing = n, i = binStart;
+        for(; i + 3 <= binEnd && nMissing > 0; i += 4)
+        {
+            const __m128 x = _mm_loadu_ps(w + i);
+            for(Int_t j = 0; j < n; j++)
+            {
+                if(bins[j] >= 0)
+                    continue;
+                if(Int_t mask = Mask4<false>(x, _mm_set1_ps(values[j])))
+                {
+                    bins[j] = i + __builtin_ctz(mask);
+                    nMissing--;
+                }
+            }
+        }
+        if(nMissing > 0)
+            CrossingsScalar(w, values, n, i, binEnd, bins);
+    }
+
+
+    template<Bool_t isGreaterOrLesser>
+    __attribute__((target("avx2")))
+    inline Int_t Mask8(__m256 x, __m256 v)
+    {
+        return _mm256_movemask_ps(_mm256_cmp_ps(x, v, isGreaterOrLesser ? _CMP_GE_OQ : _CMP_LE_OQ));
+    }
+
+    template<Bool_t isGreaterOrLesser>
+    __attribute__((target("avx2")))
+    Int_t CrossingAVX2(const Float_t* w, Float_t value, Int_t binStart, Int_t binEnd)
+    {
+        const __m256 v = _mm256_set1_ps(value);
+        Int_t i = binStart;
+        if(binStart <= binEnd)
+        {
+            for(; i + 7 <= binEnd; i += 8)
+                if(Int_t mask = Mask8<isGreaterOrLesser>(_mm256_loadu_ps(w + i), v))
+                    return i + __builtin_ctz(mask);
+        }
+        else
+        {
+            for(; i - 7 >= binEnd; i -= 8)
+                if(Int_t mask = Mask8<isGreaterOrLesser>(_mm256_loadu_ps(w + i - 7), v))
+                    return i - 7 + (31 - __builtin_clz(mask));
+        }
+        return CrossingTail<isGreaterOrLesser>(w, value, binStart, i, binEnd);
+    }
+
+    __attribute__((target("avx2")))
+    void CrossingsAVX2(const Float_t* w, const Float_t* values, Int_t n, Int_t binStart, Int_t binEnd, Int_t* bins)
+    {
+        Int_t nMissing = n, i = binStart;
+        for(; i + 7 <= binEnd && nMissing > 0; i += 8)
+        {
+            const __m256 x = _mm256_loadu_ps(w + i);
+            for(Int_t j = 0; j < n; j++)
+            {
+                if(bins[j] >= 0)
+                    continue;
+                if(Int_t mask = Mask8<false>(x, _mm256_set1_ps(values[j])))
+                {
+                    bins[j] = i + __builtin_ctz(mask);
+                    nMissing--;
+                }
+            }
+        }
+        if(nMissing > 0)
+            CrossingsScalar(w, values, n, i, binEnd, bins);
+    }
+
+
+    template<Bool_t isGreaterOrLesser>
+    __attribute__((target("avx512f")))
+    inline UInt_t Mask16(__m512 x, __m512 v)
+    {
+        return _mm512_cmp_ps_mask(x, v, isGreaterOrLesser ? _CMP_GE_OQ : _CMP_LE_OQ);
+    }
+
+    template<Bool_t isGreaterOrLesser>
+    __attribute__((target("avx512f")))
+    Int_t CrossingAVX512(const Float_t* w, Float_t value, Int_t binStart, Int_t binEnd)
+    {
+        const __m512 v = _mm512_set1_ps(value);
+        Int_t i = binStart;
+        if(binStart <= binEnd)
+        {
+            for(; i + 15 <= binEnd; i += 16)
+                if(UInt_t mask = Mask16<isGreaterOrLesser>(_mm512_loadu_ps(w + i), v))
+                    return i + __builtin_ctz(mask);
+        }
+        else
+        {
+            for(; i - 15 >= binEnd; i -= 16)
+                if(UInt_t mask = Mask16<isGreaterOrLesser>(_mm512_loadu_ps(w + i - 15), v))
+                    return i - 15 + (31 - __builtin_clz(mask));
+        }
+        return CrossingTail<isGreaterOrLesser>(w, value, binStart, i, binEnd);
+    }
+
+    __attribute__((target("avx512f")))
+    void CrossingsAVX512(const Float_t* w, const Float_t* values, Int_t n, Int_t binStart, Int_t binEnd, Int_t* bins)
+    {
+        Int_t nMissing = n, i = binStart;
+        for(; i + 15 <= binEnd && nMissing > 0; i += 16)
+        {
+            const __m512 x = _mm512_loadu_ps(w + i);
+            for(Int_t j = 0; j < n; j++)
+            {
+                if(bins[j] >= 0)
+                    continue;
+                if(UInt_t mask = Mask16<false>(x, _mm512_set1_ps(values[j])))
+                {
+                    bins[j] = i + __builtin_ctz(mask);
+                    nMissing--;
+                }
+            }
+        }
+        if(nMissing > 0)
+            CrossingsScalar(w, values, n, i, binEnd, bins);
+    }
+#endif
+
+
+    template<Bool_t isGreaterOrLesser>
+    Int_t CrossingFloat(const Float_t* w, Float_t value, Int_t binStart, Int_t binEnd)
+    {
+        switch(GetSimdLevel())
+        {
+#ifdef SIMDMPPC_X86
+            case SimdLevel::AVX512:
+                return CrossingAVX512<isGreaterOrLesser>(w, value, binStart, binEnd);
+            case SimdLevel::AVX2:
+                return CrossingAVX2<isGreaterOrLesser>(w, value, binStart, binEnd);
+            case SimdLevel::SSE42:
+                return CrossingSSE42<isGreaterOrLesser>(w, value, binStart, binEnd);
+#endif
+            case SimdLevel::Scalar:
+            default:
+                return CrossingScalar<isGreaterOrLesser>(w, value, binStart, binEnd);
+        }
+    }
+}
+
+
+
+SimdLevel GetSimdLevel()
+{
+    return CurrentSimdLevel();
+}
+
+
+
+void SetSimdLevel(SimdLevel level)
+{
+    CurrentSimdLevel() = min(level, DetectSimdLevel());
+}
+
+
+
+const char* GetSimdLevelName(SimdLevel level)
+{
+    switch(level)
+    {
+        case SimdLevel::AVX512:
+            return "avx512";
+        case SimdLevel::AVX2:
+            return "avx2";
+        case SimdLevel::SSE42:
+            return "sse4.2";
+        case SimdLevel::Scalar:
+        default:
+            return "scalar";
+    }
+}
+
+
+
+Bool_t ParseSimdLevel(const char* name, SimdLevel& level)
+{
+    if(strcmp(name, "scalar") == 0)
+        level = SimdLevel::Scalar;
+    else if(strcmp(name, "sse4.2") == 0)
+        level = SimdLevel::SSE42;
+    else if(strcmp(name, "avx2") == 0)
+        level = SimdLevel::AVX2;
+    else if(strcmp(name, "avx512") == 0)
+        level = SimdLevel::AVX512;
+    else
+        return false;
+
+    return true;
+}
+
+
+
+void MeasureWindowsMPPC(const Float_t* const times[], const Float_t* const samples[], Int_t n, const ParametersMPPC& par, EstimatorsMPPC est[])
+{
+    if(DefaultShapeMPPC::Matches(par))
+        WindowsDispatch(times, samples, n, par, DefaultShapeMPPC(), est);
+    else
+        WindowsDispatch(times, samples, n, par, DynamicShapeMPPC{par}, est);
+}
+
+
+
+Int_t FindCrossingMPPC(const Float_t* samples, Double_t value, Bool_t isGreaterOrLesser, Int_t binStart, Int_t binEnd)
+{
+    if(binStart < 0 || binEnd < 0)
+        return -1;
+
+    Float_t v = FloatThreshold(value, isGreaterOrLesser);
+    return isGreaterOrLesser ? CrossingFloat<true>(samples, v, binStart, binEnd) : CrossingFloat<false>(samples, v, binStart, binEnd);
+}
+
+
+
+Int_t FindCrossingMPPC(const Double_t* samples, Double_t value, Bool_t isGreaterOrLesser, Int_t binStart, Int_t binEnd)
+{
+    if(binStart < 0 || binEnd < 0)
+        return -1;
+
+    return isGreaterOrLesser ? CrossingScalar<true>(samples, value, binStart, binEnd) : CrossingScalar<false>(samples, value, binStart, binEnd);
+}
+
+
+
+void FindCrossingsMPPC(const Float_t* samples, const Double_t values[], Int_t n, Int_t binStart, Int_t binEnd, Int_t bins[])
+{
+    constexpr Int_t maxValues = 4*MAX_FRACTIONS;
+    Float_t v[maxValues];
+
+    for(Int_t j = 0; j < n; j++)
+        bins[j] = -1;
+    if(binStart < 0 || binEnd < 0)
+        return;
+
+    for(Int_t k = 0; k < n; k += maxValues)
+    {
+        Int_t m = min(n - k, maxValues);
+        for(Int_t j = 0; j < m; j++)
+            v[j] = FloatThreshold(values[k + j], false);
+
+        switch(GetSimdLevel())
+        {
+#ifdef SIMDMPPC_X86
+            case SimdLevel::AVX512:
+                CrossingsAVX512(samples, v, m, binStart, binEnd, bins + k);
+                break;
+            case SimdLevel::AVX2:
+                CrossingsAVX2(samples, v, m, binStart, binEnd, bins + k);
+                break;
+            case SimdLevel::SSE42:
+                CrossingsSSE42(samples, v, m, binStart, binEnd, bins + k);
+                break;
+#endif
+            case SimdLevel::Scalar:
+            default:
+                CrossingsScalar(samples, v, m, binStart, binEnd, bins + k);
+                break;
+        }
+    }
+}
+
+
+
+void FindCrossingsMPPC(const Double_t* samples, const Double_t values[], Int_t n, Int_t binStart, Int_t binEnd, Int_t bins[])
+{
+    for(Int_t j = 0; j < n; j++)
+        bins[j] = -1;
+    if(binStart < 0 || binEnd < 0)
+        return;
+
+    CrossingsScalar(samples, values, n, binStart, binEnd, bins);
+}
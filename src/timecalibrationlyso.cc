@@ -0,0 +1,97 @@
+#include "timecalibrationlyso.hh"
+
+#include <algorithm>
+
+using namespace std;
+using namespace ROOT;
+
+
+TimeCalibrationLYSO::TimeCalibrationLYSO(const vector<RVecF>& times_F, const vector<RVecF>& times_B)
+    : fClass(FACES*CHANNELS)
+{
+    const vector<RVecF>* times[FACES] = {&times_F, &times_B};
+    vector<const RVecF*> grids; // stop cell 0 grid of every calibration
+
+    for(Int_t face = 0; face < FACES; face++)
+    {
+        for(Int_t ch = 0; ch < CHANNELS; ch++)
+        {
+            const RVecF& t = (*times[face])[ch];
+            if(t.size() != SAMPLINGS)
+            {
+                cerr << "Time grid of channel " << ch << " has " << t.size() << " samples instead of " << SAMPLINGS << endl;
+            }
+
+            // Same calibration as a previous channel?
+            auto same = find_if(grids.begin(), grids.end(), [&t](const RVecF* g)
+            {
+                return g->size() == t.size() && equal(g->begin(), g->end(), t.begin());
+            });
+            if(same != grids.end())
+            {
+                fClass[face*CHANNELS + ch] = same - grids.begin();
+                continue;
+            }
+
+            fClass[face*CHANNELS + ch] = grids.size();
+            grids.push_back(&t);
+
+            // Cell widths, the last one (wrap-around) is not measured: use the mean
+            Int_t n = min<Int_t>(t.size(), SAMPLINGS);
+            vector<Double_t> widths(SAMPLINGS, n > 1 ? (Double_t(t[n-1]) - t[0]) / (n - 1) : 0.);
+            for(Int_t k = 0; k + 1 < n; k++)
+                widths[k] = Double_t(t[k+1]) - t[k];
+
+            fWidths.push_back(move(widths));
+            fStart.push_back(n > 0 ? t[0] : 0.);
+        }
+    }
+
+    Int_t nClasses = grids.size();
+    fGrids.reset(new atomic<const Float_t*>[nClasses*SAMPLINGS]);
+    for(Int_t k = 0; k < nClasses*SAMPLINGS; k++)
+        fGrids[k].store(nullptr, memory_order_relaxed);
+
+    // Stop cell 0 grids are the input ones, bit by bit
+    for(Int_t cls = 0; cls < nClasses; cls++)
+    {
+        unique_ptr<Float_t[]> grid(new Float_t[SAMPLINGS]());
+        copy_n(grids[cls]->begin(), min<Int_t>(grids[cls]->size(), SAMPLINGS), grid.get());
+        fGrids[cls*SAMPLINGS].store(grid.get(), memory_order_release);
+        fPool.push_back(move(grid));
+    }
+}
+
+
+
+Int_t TimeCalibrationLYSO::GetNGrids()
+{
+    lock_guard<mutex> lock(fPoolMutex);
+    return fPool.size();
+}
+
+
+
+const Float_t* TimeCalibrationLYSO::BuildGrid(Int_t cls, Int_t stopCell)
+{
+    lock_guard<mutex> lock(fPoolMutex);
+
+    // Built by another thread in the meantime?
+    auto& slot = fGrids[cls*SAMPLINGS + stopCell];
+    if(const Float_t* grid = slot.load(memory_order_acquire))
+        return grid;
+
+    // Sample i is in cell (stopCell + i) % SAMPLINGS
+    const auto& widths = fWidths[cls];
+    unique_ptr<Float_t[]> grid(new Float_t[SAMPLINGS]);
+    Double_t time = fStart[cls];
+    for(Int_t i = 0; i < SAMPLINGS; i++)
+    {
+        grid[i] = time;
+        time += widths[(stopCell + i) % SAMPLINGS];
+    }
+
+    slot.store(grid.get(), memory_order_release);
+    fPool.push_back(move(grid));
+    return fPool.back().get();
+}
@@ -1,13 +1,23 @@
 #include "waveformmppc.hh"
+#include "simdmppc.hh"
 
 using namespace std;
 using namespace ROOT;
 
 
-WaveformMPPC::WaveformMPPC(Int_t chid, RVecD times, RVecD volts)
+WaveformMPPC::WaveformMPPC(Int_t chid, const RVecF& times, const RVecF& volts)
+    : WaveformMPPC(chid, times.data(), volts.data(), volts.size())
+{
+}
+
+
+
+WaveformMPPC::WaveformMPPC(Int_t chid, const Float_t* times, const Float_t* volts, Int_t size)
 {
     Ch = chid;
-    fWave = WaveDRS(times, volts);
+    fTimesView = times;
+    fSamplesView = volts;
+    fSize = size;
     
     MeasureBaseline();
     fWave.SetBaseline(Baseline);
@@ -17,48 +27,90 @@ WaveformMPPC::WaveformMPPC(Int_t chid, RVecD times, RVecD volts)
 
 WaveformMPPC::WaveformMPPC(WaveDRS wave)
 {
+    Ch = -1;
     fWave = wave;
+    fSize = fWave.samples.size();
+
+    // Baseline of the wave as it is (e.g. 0 for baseline-corrected sums)
+    Baseline = fWave.baseline;
+    SigmaNoise = 0;
+}
+
+
+
+WaveformMPPC::WaveformMPPC(const Double_t* times, const Double_t* samples, Int_t size, Double_t baseline)
+{
+    // RVec views: moved in, not copied
+    Ch = -1;
+    fWave.times = RVecD(const_cast<Double_t*>(times), size);
+    fWave.samples = RVecD(const_cast<Double_t*>(samples), size);
+    fWave.SetBaseline(baseline);
+    fSize = size;
+
+    Baseline = baseline;
+    SigmaNoise = 0;
+}
+
+
+
+WaveDRS WaveformMPPC::GetWave() const
+{
+    if(!fSamplesView)
+        return fWave;
+
+    WaveDRS wave(RVecD(fTimesView, fTimesView + fSize), RVecD(fSamplesView, fSamplesView + fSize));
+    wave.SetBaseline(fWave.baseline);
+    return wave;
 }
 
 
 
 void WaveformMPPC::MeasureCharge(Int_t binStart, Int_t binStop)
 {
-    // Convention is [binStart, binStop]
-    binStop++;
-    auto w = Take(fWave.samples, binStop);
-    w = Take(w, binStart - binStop);
-    auto t = Take(fWave.times, binStop);
-    t = Take(t, binStart - binStop);
-
-    Charge = 0;
-    for(auto i = 0; i < (binStop - binStart - 1); i++)
+    // Convention is [binStart, binStop], samples are read in place
+    Charge = VisitSamples([this, binStart, binStop](const auto* t, const auto* w)
     {
-        Charge += (2*Baseline - (w[i] + w[i+1]))*(t[i+1]-t[i])*0.5;
-    }
+        Double_t charge = 0;
+        for(auto i = binStart; i < binStop; i++)
+        {
+            charge += (2*Baseline - (Double_t(w[i]) + Double_t(w[i+1])))*(Double_t(t[i+1]) - Double_t(t[i]))*0.5;
+        }
+        return charge;
+    });
 }
 
 
 
 void WaveformMPPC::MeasureAmplitude(Int_t binStart, Int_t binStop)
 {
-    // Convention is [binStart, binStop]
-    binStop++;
-    auto w = Take(fWave.samples, binStop);
-    w = Take(w, binStart - binStop);
+    SetAmplitude(binStart, binStop, ConfigAnalyzer::GetInstance()->trgLevel);
+}
 
-    Amplitude = Max(Baseline - w);
+
+
+void WaveformMPPC::SetAmplitude(Int_t binStart, Int_t binStop, Float_t trgLevel)
+{
+    // Convention is [binStart, binStop], samples are read in place
+    Amplitude = VisitSamples([this, binStart, binStop](const auto*, const auto* w)
+    {
+        Double_t amplitude = Baseline - Double_t(w[binStart]);
+        for(auto i = binStart + 1; i <= binStop; i++)
+        {
+            amplitude = TMath::Max(amplitude, Baseline - Double_t(w[i]));
+        }
+        return amplitude;
+    });
     
     // Set trigger boolean
-    Trigger = Amplitude > -ConfigAnalyzer::GetInstance()->trgLevel;
+    Trigger = Amplitude > -trgLevel;
 }
 
 
 
 void WaveformMPPC::MeasureTimeCF(Float_t frac, Int_t leFrac)
 {
-    MeasureAmplitude();
-    Double_t thr = Baseline - Amplitude*frac;
+    auto config = ConfigAnalyzer::GetInstance();
+    SetAmplitude(config->lowInt, config->upInt, config->trgLevel);
     
     if(!Trigger)
     {
@@ -66,10 +118,39 @@ void WaveformMPPC::MeasureTimeCF(Float_t frac, Int_t leFrac)
         return;
     }
 
-    Int_t trgCell = CrossingPoint(Baseline + ConfigAnalyzer::GetInstance()->trgLevel, false, ZERO_TIME_BIN, 1023);
+    Int_t trgCell = CrossingPoint(Baseline + config->trgLevel, false, ZERO_TIME_BIN, 1023);
+    TimeCFOf(leFrac) = TimeCF(frac, leFrac, trgCell, config->trgLevel);
+}
+
+
+
+template<typename Fractions>
+void WaveformMPPC::MeasureTimesCF(const ParametersMPPC& par)
+{
+    SetAmplitude(par.lowInt, par.upInt, par.trgLevel);
+    
+    if(!Trigger)
+    {
+        TimeCF15 = -1; TimeCF25 = -1; TimeCF50 = -1;
+        return;
+    }
+
+    // Fixed number of fractions and destinations: unrolled, no switch left
+    Int_t trgCell = CrossingPoint(Baseline + par.trgLevel, false, ZERO_TIME_BIN, 1023);
+    for(Int_t j = 0; j < Fractions::N; j++)
+        TimeCFOf(Fractions::percents[j]) = TimeCF(Fractions::values[j], Fractions::percents[j], trgCell, par.trgLevel);
+}
+
+template void WaveformMPPC::MeasureTimesCF<DefaultFractionsMPPC>(const ParametersMPPC&);
+
+
+
+Double_t WaveformMPPC::TimeCF(Float_t frac, Int_t leFrac, Int_t trgCell, Float_t trgLevel)
+{
+    Double_t thr = Baseline - Amplitude*frac;
     Int_t binOfTimeSup, binOfTimeInf;
 
-    if(thr < (Baseline + ConfigAnalyzer::GetInstance()->trgLevel))
+    if(thr < (Baseline + trgLevel))
     {
         binOfTimeSup = CrossingPoint(thr, false, trgCell, 1023);
         binOfTimeInf = CrossingPoint(thr, true, binOfTimeSup, ZERO_TIME_BIN);
@@ -80,8 +161,12 @@ void WaveformMPPC::MeasureTimeCF(Float_t frac, Int_t leFrac)
         binOfTimeSup = CrossingPoint(thr, false, binOfTimeInf, 1023);
     }
 
-    pair<Double_t, Double_t> infSample = make_pair(fWave.times[binOfTimeInf], fWave.samples[binOfTimeInf]);
-    pair<Double_t, Double_t> supSample = make_pair(fWave.times[binOfTimeSup], fWave.samples[binOfTimeSup]);
+    auto sampleAt = [this](Int_t bin)
+    {
+        return VisitSamples([bin](const auto* t, const auto* w) { return make_pair(Double_t(t[bin]), Double_t(w[bin])); });
+    };
+    pair<Double_t, Double_t> infSample = sampleAt(binOfTimeInf);
+    pair<Double_t, Double_t> supSample = sampleAt(binOfTimeSup);
 
     // Linear interpolation
     Double_t fTimeCF = ((thr - infSample.second)/(supSample.second - infSample.second))*(supSample.first - infSample.first) + infSample.first;
@@ -91,19 +176,7 @@ void WaveformMPPC::MeasureTimeCF(Float_t frac, Int_t leFrac)
         cerr << "Le PROBLEM for frac = " << leFrac << "Threshold at " << thr << " Estimation at = " << fTimeCF << endl;
     }
 
-    switch(leFrac)
-    {
-        case 15:
-        default:
-            TimeCF15 = fTimeCF;
-            break;
-        case 25:
-            TimeCF25 = fTimeCF;
-            break;
-        case 50:
-            TimeCF50 = fTimeCF;
-            break;
-    }
+    return fTimeCF;
 }
 
 
@@ -113,50 +186,36 @@ void WaveformMPPC::MeasureBaseline(Int_t binStart, Int_t binStop)
     if(binStart >= binStop)
         cerr << "Limits not valid!" << endl;
 
-    // Convention is [binStart, binStop]
-    binStop++;
-    auto w = Take(fWave.samples, binStop);
-    w = Take(w, binStart - binStop);
+    // Convention is [binStart, binStop], samples are read in place.
+    // Same double accumulation as VecOps::Mean and VecOps::StdDev
+    VisitSamples([this, binStart, binStop](const auto*, const auto* w)
+    {
+        Double_t sum = 0, sumSquares = 0;
+        for(auto i = binStart; i <= binStop; i++)
+        {
+            Double_t x = w[i];
+            sum += x;
+            sumSquares += x*x;
+        }
+        Double_t n = binStop - binStart + 1;
 
-    Baseline = Mean(w);
-    SigmaNoise = StdDev(w);
+        Baseline = sum / n;
+        SigmaNoise = n < 2 ? 0. : TMath::Sqrt(1. / (n - 1.) * (sumSquares - sum*sum / n));
+    });
 }
 
 
 
 Int_t WaveformMPPC::CrossingPoint(Double_t value, Bool_t isGreaterOrLesser, Int_t binStart, Int_t binEnd)
 {
-    auto& data = fWave.samples;
-
-    // Lambda function for comparison
-    auto compare = [value, isGreaterOrLesser](Double_t sample)
+    // Block search with a movemask reduction on the float views
+    Int_t crossing = VisitSamples([value, isGreaterOrLesser, binStart, binEnd](const auto*, const auto* data)
     {
-        return isGreaterOrLesser ? sample >= value : sample <= value;
-    };
+        return FindCrossingMPPC(data, value, isGreaterOrLesser, binStart, binEnd);
+    });
 
-    // Check for search direction based on binStart and binEnd
-    if(binStart <= binEnd)
-    {
-        // Forward search
-        for (Int_t i = binStart; i <= binEnd; ++i)
-        {
-            if (compare(data[i]))
-            {
-                return i; // Return the bin index where the condition is first met
-            }
-        }
-    }
-    else
-    {
-        // Reverse search
-        for (Int_t i = binStart; i >= binEnd; --i)
-        {
-            if (compare(data[i]))
-            {
-                return i; // Return the bin index where the condition is first met
-            }
-        }
-    }
+    if(crossing >= 0)
+        return crossing;
 
     // No crossing point found
     cerr << "ERROR! CROSSING POINT NOT FOUND for value: " << value << ", starting from bin: " << binStart << " to bin: " << binEnd << endl;
@@ -0,0 +1,146 @@
+//****************************************************************************//
+//                                                                            //
+//     Test: the analysis of an event doesn't allocate after the warm-up      //
+//                                                                            //
+//****************************************************************************//
+
+#include <iostream>
+#include <vector>
+#include <cerrno>
+
+#include <ROOT/RVec.hxx>
+
+#include "globals.hh"
+#include "configure.hh"
+#include "eventlyso.hh"
+#include "timecalibrationlyso.hh"
+#include "generatorlyso.hh"
+
+using namespace std;
+using namespace ROOT;
+
+
+//----------------------------------------------------------------------------//
+// Heap allocations of the calling thread. With glibc the malloc family of the
+// executable takes the place of the libc one, so both operator new and the
+// RVec buffers (malloc) are counted
+//----------------------------------------------------------------------------//
+#if defined(__GLIBC__)
+#define TEST_COUNTS_ALLOCATIONS 1
+
+extern "C"
+{
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t n, size_t size);
+    void* __libc_realloc(void* p, size_t size);
+    void* __libc_memalign(size_t alignment, size_t size);
+}
+
+namespace
+{
+    thread_local ULong64_t nAllocations = 0;
+}
+
+extern "C"
+{
+    void* malloc(size_t size) noexcept { nAllocations++; return __libc_malloc(size); }
+    void* calloc(size_t n, size_t size) noexcept { nAllocations++; return __libc_calloc(n, size); }
+    void* realloc(void* p, size_t size) noexcept { nAllocations++; return __libc_realloc(p, size); }
+    void* aligned_alloc(size_t alignment, size_t size) noexcept { nAllocations++; return __libc_memalign(alignment, size); }
+    int posix_memalign(void** p, size_t alignment, size_t size) noexcept
+    {
+        nAllocations++;
+        *p = __libc_memalign(alignment, size);
+        return *p || size == 0 ? 0 : ENOMEM;
+    }
+}
+#endif
+
+
+namespace
+{
+    // Exit code of a skipped test (SKIP_RETURN_CODE in CMakeLists.txt)
+    constexpr int SKIPPED = 77;
+
+    template<typename T>
+    inline void KeepAlive(const T& x)
+    {
+        asm volatile("" : : "g"(&x) : "memory");
+    }
+
+
+
+    // Heap allocations per event of the analysis as in LoopAnalyzer (one
+    // EventLYSO reloaded with Load) after a warm-up over all the events, -1 if
+    // they can't be counted. The steady state must be 0
+    Double_t CountAllocations(const GeneratorLYSO& generator, const vector<GeneratedEventLYSO>& events, Long64_t nEvents)
+    {
+#ifdef TEST_COUNTS_ALLOCATIONS
+        TimeCalibrationLYSO& calibration = *generator.GetCalibration();
+        const Float_t* grids[FACES*CHANNELS];
+        for(Int_t face = 0; face < FACES; face++)
+        {
+            for(Int_t ch = 0; ch < CHANNELS; ch++)
+                grids[face*CHANNELS + ch] = calibration.GetTimes(face, ch);
+        }
+
+        EventLYSO eventlyso;
+        auto analyze = [&events, &grids, &eventlyso](Long64_t k)
+        {
+            const GeneratedEventLYSO& e = events[k % events.size()];
+            eventlyso.Load(k, grids, e.volts_F, e.volts_B);
+            eventlyso.CalculateEstimatorsForEveryMPPC();
+            eventlyso.MeasureDetectorCharge();
+            eventlyso.MeasureDetectorTime();
+            eventlyso.MeasureDetectorPosition();
+            KeepAlive(eventlyso);
+        };
+
+        for(size_t k = 0; k < 2*events.size(); k++)
+            analyze(k);
+
+        ULong64_t start = nAllocations;
+        for(Long64_t k = 0; k < nEvents; k++)
+            analyze(k);
+        return Double_t(nAllocations - start)/nEvents;
+#else
+        return -1;
+#endif
+    }
+}
+
+
+
+int main()
+{
+    // analyze.mac defaults
+    auto config = ConfigAnalyzer::GetInstance();
+    config->trgLevel = -0.050;
+    config->lowBase = 100;
+    config->upBase = 300;
+    config->lowInt = 400;
+    config->upInt = 1000;
+    config->nCircles_Time = 1;
+    config->nCircles_Position = 1;
+
+    GeneratorLYSO generator;
+    vector<GeneratedEventLYSO> events(16);
+    for(size_t k = 0; k < events.size(); k++)
+        generator.Generate(k, events[k]);
+
+    Double_t allocations = CountAllocations(generator, events, 1000);
+    if(allocations < 0)
+    {
+        cout << "TestLYSO>> Heap allocations can't be counted without glibc" << endl;
+        return SKIPPED;
+    }
+
+    cout << "TestLYSO>> Heap allocations per event after warm-up: " << allocations << endl;
+    if(allocations > 0)
+    {
+        cerr << "TestLYSO>> ERROR! The analysis of an event allocates after the warm-up" << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,134 @@
+//****************************************************************************//
+//                                                                            //
+//     Test: a scan point gives the output of a plain run with its config     //
+//                                                                            //
+//****************************************************************************//
+
+#include <iostream>
+#include <vector>
+#include <cstring>
+
+#include <ROOT/RVec.hxx>
+
+#include "globals.hh"
+#include "configure.hh"
+#include "eventlyso.hh"
+#include "scanlyso.hh"
+#include "timecalibrationlyso.hh"
+#include "generatorlyso.hh"
+
+using namespace std;
+using namespace ROOT;
+
+
+namespace
+{
+    void ApplyToConfig(const ParametersLYSO& p)
+    {
+        auto config = ConfigAnalyzer::GetInstance();
+        config->trgLevel = p.mppc.trgLevel;
+        config->lowBase = p.mppc.lowBase;
+        config->upBase = p.mppc.upBase;
+        config->lowInt = p.mppc.lowInt;
+        config->upInt = p.mppc.upInt;
+        config->nCircles_Time = p.nCircles_Time;
+        config->nCircles_Position = p.nCircles_Position;
+    }
+
+
+
+    // Every estimator written to lyso_est
+    vector<Double_t> GetOutput(const EventLYSO& event)
+    {
+        vector<Double_t> out;
+        auto add = [&out](const Double_t* x, Int_t n) { out.insert(out.end(), x, x + n); };
+        for(Int_t face = 0; face < FACES; face++)
+        {
+            out.push_back(event.GetCharge(face));
+            add(event.GetTime15(face), 5);
+            add(event.GetTime25(face), 5);
+            add(event.GetTime50(face), 5);
+            add(event.GetCentroid(face), 4);
+            add(event.GetCharges(face), CHANNELS);
+            add(event.GetAmplitudes(face), CHANNELS);
+            add(event.GetTimeCFs15(face), CHANNELS);
+            add(event.GetTimeCFs25(face), CHANNELS);
+            add(event.GetTimeCFs50(face), CHANNELS);
+            for(Int_t ch = 0; ch < CHANNELS; ch++)
+                out.push_back(event.GetTriggers(face)[ch]);
+        }
+        out.push_back(event.GetChargeTot());
+        return out;
+    }
+}
+
+
+
+int main()
+{
+    // analyze.mac defaults
+    ParametersLYSO base;
+    ApplyToConfig(base);
+
+    // Only another integration window (shared baselines), other windows, then
+    // only another trgLevel (shared charges and amplitudes)
+    ParametersLYSO integral = base;
+    integral.mppc.lowInt = 380;
+    integral.mppc.upInt = 900;
+    ParametersLYSO point = base;
+    point.mppc.trgLevel = -0.040;
+    point.mppc.lowBase = 80;
+    point.mppc.upBase = 320;
+    point.mppc.lowInt = 380;
+    point.mppc.upInt = 900;
+    point.nCircles_Time = 2;
+    point.nCircles_Position = 2;
+    ParametersLYSO trigger = point;
+    trigger.mppc.trgLevel = -0.030;
+    ScanLYSO scan({base, integral, point, trigger});
+
+    GeneratorLYSO generator;
+    TimeCalibrationLYSO& calibration = *generator.GetCalibration();
+    const Float_t* grids[FACES*CHANNELS];
+    for(Int_t face = 0; face < FACES; face++)
+    {
+        for(Int_t ch = 0; ch < CHANNELS; ch++)
+            grids[face*CHANNELS + ch] = calibration.GetTimes(face, ch);
+    }
+
+    Int_t nErrors = 0;
+    GeneratedEventLYSO generated;
+    EventLYSO scanned, plain;
+    for(Long64_t evt = 0; evt < 8; evt++)
+    {
+        generator.Generate(evt, generated);
+
+        vector<vector<Double_t>> outputs(scan.GetSize());
+        ApplyToConfig(base);
+        scanned.Load(evt, grids, generated.volts_F, generated.volts_B);
+        scan.ForEachPoint(scanned, [&outputs](Int_t k, const EventLYSO& event) { outputs[k] = GetOutput(event); });
+
+        for(Int_t k = 0; k < scan.GetSize(); k++)
+        {
+            ApplyToConfig(scan.GetPoint(k));
+            plain.Load(evt, grids, generated.volts_F, generated.volts_B);
+            plain.CalculateEstimatorsForEveryMPPC();
+            plain.MeasureDetectorCharge();
+            plain.MeasureDetectorTime();
+            plain.MeasureDetectorPosition();
+
+            vector<Double_t> expected = GetOutput(plain);
+            if(expected.size() != outputs[k].size() || memcmp(expected.data(), outputs[k].data(), expected.size()*sizeof(Double_t)) != 0)
+            {
+                cerr << "TestLYSO>> ERROR! Event " << evt << ", scan point " << k << " differs from a plain run with its config" << endl;
+                nErrors++;
+            }
+        }
+    }
+
+    if(nErrors)
+        return 1;
+
+    cout << "TestLYSO>> Scan points match the plain runs" << endl;
+    return 0;
+}